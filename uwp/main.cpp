@@ -5,7 +5,19 @@
 #include <cstring>
 #include <fstream>
 #include <map>
+#include <algorithm>
 #include <cmath>
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TEXT_SIMD_SSE2 1
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define TEXT_SIMD_NEON 1
+#endif
 
 #include "glad/glad.h"
 #include "SDL2/SDL.h"
@@ -13,26 +25,600 @@
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
 
-// Glyph information
+// Number of frames the CPU may run ahead of the GPU on streamed geometry
+const int kStreamFramesInFlight = 3;
+
+// Ring buffer that all per-frame dynamic geometry suballocates from. Each frame in flight
+// owns one region guarded by a fence. With ARB_buffer_storage the whole buffer stays
+// persistently and coherently mapped; otherwise each allocation is mapped unsynchronized.
+struct StreamBuffer {
+	GLuint buffer;
+	size_t regionSize;                       // Bytes per frame in flight
+	int region;                              // Region written by the current frame
+	size_t offset;                           // Write cursor inside the current region
+	unsigned char* mapped;                   // Persistent mapping of the whole ring, or NULL
+	bool persistent;
+	GLsync fences[kStreamFramesInFlight];
+	
+	StreamBuffer() : buffer(0), regionSize(0), region(0), offset(0), mapped(NULL), persistent(false) {
+		for (int i = 0; i < kStreamFramesInFlight; i++) fences[i] = 0;
+	}
+};
+
+// A suballocation returned by allocStream; write through ptr, then call commitStream
+struct StreamAllocation {
+	unsigned char* ptr;
+	size_t offset;   // Byte offset inside StreamBuffer::buffer, for attribute pointers
+	size_t size;
+};
+
+// Glyph information, packed into 16 bytes so four glyphs share a cache line
 struct Glyph {
-	float x0, y0, x1, y1;  // Texture coordinates
-	float xoff, yoff;      // Offset from baseline
-	float advance;         // Advance width
-	int width, height;     // Glyph dimensions
+	uint16_t x, y;            // Top-left corner in the atlas, in texels
+	uint16_t width, height;   // Glyph dimensions in texels
+	int16_t xoff, yoff;       // Offset from baseline in pixels
+	uint16_t advance;         // Advance width in 1/64 pixel
+	uint16_t flags;           // kGlyphPresent for occupied table slots, font face in bits 4..7
+};
+
+const uint16_t kGlyphPresent = 0x0001;
+const uint16_t kGlyphCached = 0x0002;    // Lives in the dynamic glyph cache; page index in the high byte
+const int kGlyphFaceShift = 4;
+
+// Index of the font collection face the glyph was rasterized from
+inline int glyphFace(const Glyph& glyph) {
+	return (glyph.flags >> kGlyphFaceShift) & 0xF;
+}
+
+inline float glyphAdvance(const Glyph& glyph) {
+	return (float)glyph.advance * (1.0f / 64.0f);
+}
+
+// Codepoints below this are looked up by direct indexing, everything else in the sparse table
+const uint32_t kGlyphDenseCount = 256;
+
+// Glyph store: a dense array for the common range plus a sorted table for the rest
+struct GlyphTable {
+	Glyph dense[kGlyphDenseCount];
+	std::vector<std::pair<uint32_t, Glyph>> sparse;  // Sorted by codepoint
+	size_t count;
+	
+	GlyphTable() : count(0) { memset(dense, 0, sizeof(dense)); }
+};
+
+inline const Glyph* findGlyph(const GlyphTable& table, uint32_t codepoint) {
+	if (codepoint < kGlyphDenseCount) {
+		const Glyph& glyph = table.dense[codepoint];
+		return (glyph.flags & kGlyphPresent) ? &glyph : NULL;
+	}
+	auto it = std::lower_bound(table.sparse.begin(), table.sparse.end(), codepoint,
+		[](const std::pair<uint32_t, Glyph>& entry, uint32_t cp) { return entry.first < cp; });
+	return (it != table.sparse.end() && it->first == codepoint) ? &it->second : NULL;
+}
+
+void insertGlyph(GlyphTable& table, uint32_t codepoint, Glyph glyph) {
+	glyph.flags |= kGlyphPresent;
+	if (codepoint < kGlyphDenseCount) {
+		if (!(table.dense[codepoint].flags & kGlyphPresent)) table.count++;
+		table.dense[codepoint] = glyph;
+		return;
+	}
+	auto it = std::lower_bound(table.sparse.begin(), table.sparse.end(), codepoint,
+		[](const std::pair<uint32_t, Glyph>& entry, uint32_t cp) { return entry.first < cp; });
+	if (it != table.sparse.end() && it->first == codepoint) {
+		it->second = glyph;
+		return;
+	}
+	table.sparse.insert(it, std::make_pair(codepoint, glyph));
+	table.count++;
+}
+
+void eraseGlyph(GlyphTable& table, uint32_t codepoint) {
+	if (codepoint < kGlyphDenseCount) {
+		if (table.dense[codepoint].flags & kGlyphPresent) table.count--;
+		memset(&table.dense[codepoint], 0, sizeof(Glyph));
+		return;
+	}
+	auto it = std::lower_bound(table.sparse.begin(), table.sparse.end(), codepoint,
+		[](const std::pair<uint32_t, Glyph>& entry, uint32_t cp) { return entry.first < cp; });
+	if (it != table.sparse.end() && it->first == codepoint) {
+		table.sparse.erase(it);
+		table.count--;
+	}
+}
+
+void clearGlyphTable(GlyphTable& table) {
+	memset(table.dense, 0, sizeof(table.dense));
+	table.sparse.clear();
+	table.count = 0;
+}
+
+// Kerning adjustments for codepoint pairs of the loaded glyph set, extracted once when the
+// atlas is built. Open addressing with linear probing; only non-zero pairs are stored.
+struct KerningTable {
+	std::vector<uint64_t> keys;     // (first << 32) | second, 0 marks an empty slot
+	std::vector<int16_t> values;    // Adjustment in 1/64 pixel at the atlas font size
+	uint64_t mask;
+	size_t count;
+	
+	KerningTable() : mask(0), count(0) {}
+};
+
+inline uint64_t kerningKey(uint32_t first, uint32_t second) {
+	return ((uint64_t)first << 32) | second;
+}
+
+inline size_t kerningSlot(uint64_t key, uint64_t mask) {
+	return (size_t)(((key * 0x9E3779B97F4A7C15ull) >> 29) & mask);
+}
+
+// Adjustment to add to the pen position between first and second, in 1/64 pixel
+inline int findKerning(const KerningTable& table, uint32_t first, uint32_t second) {
+	if (table.count == 0) return 0;
+	uint64_t key = kerningKey(first, second);
+	for (size_t slot = kerningSlot(key, table.mask); ; slot = (slot + 1) & table.mask) {
+		if (table.keys[slot] == key) return table.values[slot];
+		if (table.keys[slot] == 0) return 0;
+	}
+}
+
+typedef std::vector<std::pair<uint64_t, int16_t>> KerningPairs;
+
+// Append the non-zero kern/GPOS adjustments of one font for every pair of the given glyphs
+void collectKerningPairs(KerningPairs& pairs, const stbtt_fontinfo& font, float scale,
+						 const std::vector<uint32_t>& codepoints, const std::vector<int>& glyphIndices) {
+	if (!font.kern && !font.gpos) return;
+	
+	for (size_t a = 0; a < codepoints.size(); a++) {
+		if (!glyphIndices[a]) continue;
+		for (size_t b = 0; b < codepoints.size(); b++) {
+			if (!glyphIndices[b]) continue;
+			int kern = stbtt_GetGlyphKernAdvance(&font, glyphIndices[a], glyphIndices[b]);
+			int value = (int)lroundf((float)kern * scale * 64.0f);
+			if (value != 0) {
+				pairs.push_back(std::make_pair(kerningKey(codepoints[a], codepoints[b]), (int16_t)value));
+			}
+		}
+	}
+}
+
+void buildKerningTable(KerningTable& table, const KerningPairs& pairs) {
+	table.keys.clear();
+	table.values.clear();
+	table.mask = 0;
+	table.count = 0;
+	if (pairs.empty()) return;
+	
+	// Keep the load factor at or below 50% so misses stop after a probe or two
+	size_t capacity = 16;
+	while (capacity < pairs.size() * 2) capacity *= 2;
+	table.keys.assign(capacity, 0);
+	table.values.assign(capacity, 0);
+	table.mask = capacity - 1;
+	for (const auto& pair : pairs) {
+		size_t slot = kerningSlot(pair.first, table.mask);
+		while (table.keys[slot] != 0) slot = (slot + 1) & table.mask;
+		table.keys[slot] = pair.first;
+		table.values[slot] = pair.second;
+	}
+	table.count = pairs.size();
+}
+
+// Skyline rectangle packer (bottom-left heuristic). Each node is a horizontal segment of
+// the skyline; a rect is placed where its top edge ends up lowest.
+struct SkylineNode {
+	int x, y, width;
+};
+
+struct SkylinePacker {
+	int width, height;
+	std::vector<SkylineNode> nodes;
+	
+	SkylinePacker() : width(0), height(0) {}
+};
+
+void resetSkyline(SkylinePacker& packer, int width, int height) {
+	packer.width = width;
+	packer.height = height;
+	packer.nodes.clear();
+	packer.nodes.push_back({ 0, 0, width });
+}
+
+// Lowest y at which a w x h rect fits with its left edge on node index, or -1
+static int skylineFit(const SkylinePacker& packer, size_t index, int w, int h) {
+	int x = packer.nodes[index].x;
+	if (x + w > packer.width) return -1;
+	int y = 0;
+	int remaining = w;
+	for (size_t i = index; remaining > 0; i++) {
+		if (i >= packer.nodes.size()) return -1;
+		if (packer.nodes[i].y > y) y = packer.nodes[i].y;
+		if (y + h > packer.height) return -1;
+		remaining -= packer.nodes[i].width;
+	}
+	return y;
+}
+
+bool skylineInsert(SkylinePacker& packer, int w, int h, int& outX, int& outY) {
+	int bestY = INT32_MAX, bestWidth = INT32_MAX;
+	size_t bestIndex = (size_t)-1;
+	for (size_t i = 0; i < packer.nodes.size(); i++) {
+		int y = skylineFit(packer, i, w, h);
+		if (y < 0) continue;
+		if (y + h < bestY || (y + h == bestY && packer.nodes[i].width < bestWidth)) {
+			bestY = y + h;
+			bestWidth = packer.nodes[i].width;
+			bestIndex = i;
+		}
+	}
+	if (bestIndex == (size_t)-1) return false;
+	
+	outX = packer.nodes[bestIndex].x;
+	outY = bestY - h;
+	
+	// Raise the skyline under the new rect, trimming or removing the nodes it covers
+	SkylineNode node = { outX, bestY, w };
+	packer.nodes.insert(packer.nodes.begin() + bestIndex, node);
+	for (size_t i = bestIndex + 1; i < packer.nodes.size(); ) {
+		SkylineNode& next = packer.nodes[i];
+		int shrink = (node.x + node.width) - next.x;
+		if (shrink <= 0) break;
+		next.x += shrink;
+		next.width -= shrink;
+		if (next.width > 0) break;
+		packer.nodes.erase(packer.nodes.begin() + i);
+	}
+	for (size_t i = 0; i + 1 < packer.nodes.size(); ) {
+		if (packer.nodes[i].y == packer.nodes[i + 1].y) {
+			packer.nodes[i].width += packer.nodes[i + 1].width;
+			packer.nodes.erase(packer.nodes.begin() + i + 1);
+		} else {
+			i++;
+		}
+	}
+	return true;
+}
+
+// The dynamic glyph cache owns a band of atlas rows below the baked glyphs, as wide as the
+// atlas and split into pages sized from the font (see glyphCachePageHeight). Glyphs missing
+// from the baked set are rasterized into a page on first use. When no page has room, the
+// least recently used page that was not sampled this frame is evicted as a whole, which
+// keeps quads already queued this frame valid.
+const int kGlyphCachePages = 4;
+
+struct GlyphCachePage {
+	SkylinePacker packer;
+	uint64_t lastUsed;                   // Frame this page was last sampled
+	std::vector<uint32_t> codepoints;    // Glyphs resident in this page
+	
+	GlyphCachePage() : lastUsed(0) {}
+};
+
+struct GlyphCache {
+	int originY;                         // First atlas row owned by the cache
+	int width, height;
+	std::vector<unsigned char> pixels;   // CPU mirror of the cache rows
+	GlyphCachePage pages[kGlyphCachePages];
+	int dirtyX0, dirtyY0, dirtyX1, dirtyY1;  // Rows/columns waiting for upload, empty when x0 >= x1
+	uint32_t generation;                 // Bumped on eviction so retained layouts rebuild
+	uint32_t touchedPages;               // Bit per page looked up since a layout build started
+	bool deferred;                       // A glyph found no room since then and was left out
+	
+	GlyphCache() : originY(0), width(0), height(0), dirtyX0(0), dirtyY0(0), dirtyX1(0), dirtyY1(0), generation(0),
+				   touchedPages(0), deferred(false) {}
+};
+
+// Glyph outlines for vector text, read by the fragment shader through an RGBA32F buffer
+// texture. Each glyph is one record appended on first use (see appendGlyphOutline) and
+// kept until the font is prepared again; nothing is ever rasterized.
+struct GlyphOutlines {
+	std::vector<float> texels;   // CPU mirror, 4 floats per texel
+	size_t uploaded;             // Texels already in buffer
+	size_t capacity;             // Texels buffer has storage for
+	size_t maxTexels;            // GL_MAX_TEXTURE_BUFFER_SIZE
+	GLuint buffer, texture;
+	
+	GlyphOutlines() : uploaded(0), capacity(0), maxTexels(0), buffer(0), texture(0) {}
+};
+
+// Codepoint to glyph index for one face, decoded from its cmap once when the face is opened.
+// Unicode is split into 256-codepoint pages; pages without glyphs all share the zero page 0,
+// so the BMP of a Latin font costs a few pages and a lookup is two loads.
+const uint32_t kCmapPageCount = 0x110000 >> 8;
+
+struct CmapTable {
+	std::vector<uint16_t> pages;     // kCmapPageCount entries, page number in glyphs
+	std::vector<uint16_t> glyphs;    // 256 glyph indices per page, page 0 all zero
+};
+
+inline int findCmapGlyph(const CmapTable& cmap, uint32_t codepoint) {
+	if (codepoint >= 0x110000 || cmap.pages.empty()) return 0;
+	return cmap.glyphs[((size_t)cmap.pages[codepoint >> 8] << 8) | (codepoint & 0xFF)];
+}
+
+// A loaded TTF kept open so glyphs can be rasterized after startup
+struct FontFace {
+	std::vector<unsigned char> data;     // File contents, referenced by info
+	stbtt_fontinfo info;
+	CmapTable cmap;
+	float scale;                         // stbtt scale for TextRenderer::fontSize
+	bool loaded;
+	
+	FontFace() : scale(0.0f), loaded(false) { memset(&info, 0, sizeof(info)); }
+};
+
+// Faces of a font collection are tried in order for each codepoint (primary face first)
+const int kMaxFontFaces = 16;
+
+// Where a codepoint resolved to in the fallback chain
+struct FaceGlyph {
+	int face;         // -1 when no face has the codepoint
+	int glyphIndex;
+};
+
+FaceGlyph resolveFaceGlyph(const std::vector<FontFace>& faces, uint32_t codepoint) {
+	FaceGlyph resolved = { -1, 0 };
+	for (size_t i = 0; i < faces.size(); i++) {
+		int glyphIndex = findCmapGlyph(faces[i].cmap, codepoint);
+		if (glyphIndex != 0) {
+			resolved.face = (int)i;
+			resolved.glyphIndex = glyphIndex;
+			break;
+		}
+	}
+	return resolved;
+}
+
+// What the atlas texels hold, switchable at runtime so both can be compared
+enum class AtlasMode {
+	Coverage,       // Antialiased coverage rasterized at fontSize; blurs when scaled
+	DistanceField,  // Signed distance to the outline, sharp at any scale; edge at kSdfOnEdge
+	Vector          // No atlas: outlines in a buffer texture, coverage computed per pixel (see GlyphOutlines)
+};
+
+// Distance field parameters: kSdfPadding texels of falloff around each glyph, mapped so
+// the full padding spans the 0..kSdfOnEdge range
+const int kSdfPadding = 4;
+const unsigned char kSdfOnEdge = 128;
+const float kSdfPixelDistScale = (float)kSdfOnEdge / (float)kSdfPadding;
+
+// Coverage atlases can hold each glyph rasterized at several horizontal subpixel offsets,
+// stored side by side; layout snaps the pen to a whole pixel and picks the nearest variant
+const int kMaxSubpixelPhases = 4;
+
+// Coverage and distance field atlases carry kAtlasMipLevels levels, each a 2x2 box filter of
+// the one above, so minified text samples a level near its on-screen size. Glyphs sit on a
+// kAtlasGutter grid with at least kAtlasGutter empty texels after them: a glyph then owns
+// whole blocks at every level and stays a texel clear of its neighbours at the smallest.
+const int kAtlasMipLevels = 3;
+const int kAtlasGutter = 1 << (kAtlasMipLevels - 1);
+
+inline int alignToGutter(int n) {
+	return (n + kAtlasGutter - 1) & ~(kAtlasGutter - 1);
+}
+
+// Atlas room for a w x h bitmap: the bitmap, its gutter and the grid alignment
+inline int glyphCellStride(int width) {
+	return alignToGutter(width + kAtlasGutter);
+}
+
+// Subpixel variants an atlas of mode really holds: only coverage atlases have more than one
+inline int atlasSubpixelPhases(AtlasMode mode, int subpixelPhases) {
+	if (mode != AtlasMode::Coverage || subpixelPhases < 1) return 1;
+	return std::min(subpixelPhases, kMaxSubpixelPhases);
+}
+
+// Atlas width of a glyph's variants: phases cells of width texels, glyphCellStride apart
+inline int glyphStripWidth(int width, int subpixelPhases) {
+	return (subpixelPhases - 1) * glyphCellStride(width) + width;
+}
+
+// Bytes of an atlas mip chain: every level stored tightly, largest first
+inline size_t atlasMipChainSize(int width, int height) {
+	size_t size = 0;
+	for (int level = 0; level < kAtlasMipLevels; level++) {
+		size += (size_t)(width >> level) * (height >> level);
+	}
+	return size;
+}
+
+// Glyph submission path, switchable at runtime so both can be benchmarked
+enum class TextPipeline {
+	Quads,      // 4 vertices + 6 shared indices per glyph
+	Instanced   // 1 GlyphInstance per glyph, corners generated from gl_VertexID
+};
+
+// Distance field outline and drop shadow. Both are off by default (alpha 0); the shadow
+// costs a second atlas sample per fragment only while it is on.
+struct TextEffects {
+	float outlineColor[4];
+	float outlineWidth;        // In distance units, 0..0.5
+	float shadowColor[4];
+	float shadowOffset[2];     // In atlas texels
+	
+	TextEffects() : outlineColor{ 0.0f, 0.0f, 0.0f, 0.0f }, outlineWidth(0.1f),
+					shadowColor{ 0.0f, 0.0f, 0.0f, 0.0f }, shadowOffset{ 1.5f, 1.5f } {}
 };
 
 // Simple text rendering using OpenGL
 struct TextRenderer {
 	GLuint vao, vbo, ebo, program, fontTexture;
+	GLint screenSizeLoc, fontTextureLoc;
+	size_t indexQuadCapacity;  // Quads covered by the shared index buffer
+	GLuint instanceVao, instanceVbo, instanceProgram;
+	GLint instanceScreenSizeLoc, instanceFontTextureLoc;
+	StreamBuffer* stream;      // Shared per-frame geometry ring; NULL uploads through vbo/instanceVbo
+	TextPipeline pipeline;
 	int windowWidth, windowHeight;
 	int fontTextureWidth, fontTextureHeight;
 	float fontSize;
-	std::map<unsigned char, Glyph> glyphs;
+	GlyphTable glyphs;
+	KerningTable kerning;
+	std::vector<FontFace> faces;              // Fallback chain; info points into data, so never copied
+	GlyphCache glyphCache;
+	GlyphOutlines outlines;    // Used instead of fontTexture in AtlasMode::Vector
+	uint64_t frame;            // Advanced by beginTextFrame, drives glyph cache LRU
+	uint32_t metricsGeneration; // Bumped when glyph metrics change (font size or mode); keys line measurements
 	float fontScale;
+	AtlasMode atlasMode;       // Contents of fontTexture; programs are built to match
+	int subpixelPhases;        // Horizontal variants per glyph in fontTexture, 1 when off
+	TextEffects effects;       // Applied to distance field programs, see setTextEffects
 	
 	TextRenderer() : vao(0), vbo(0), ebo(0), program(0), fontTexture(0), 
+					 screenSizeLoc(-1), fontTextureLoc(-1), indexQuadCapacity(0),
+					 instanceVao(0), instanceVbo(0), instanceProgram(0),
+					 instanceScreenSizeLoc(-1), instanceFontTextureLoc(-1),
+					 stream(NULL), pipeline(TextPipeline::Quads),
 					 windowWidth(0), windowHeight(0), fontTextureWidth(0), 
-					 fontTextureHeight(0), fontSize(32.0f), fontScale(1.0f) {}
+					 fontTextureHeight(0), fontSize(32.0f), frame(1), metricsGeneration(0), fontScale(1.0f),
+					 atlasMode(AtlasMode::Coverage), subpixelPhases(1) {}
+};
+
+// One corner of a glyph quad: screen position, atlas texture coordinates and color
+struct TextVertex {
+	float x, y;
+	float u, v;
+	uint32_t color;              // RGBA8, see packTextColor
+};
+
+// One glyph for the instanced pipeline: 28 bytes instead of 4 vertices + 6 indices (104 bytes)
+struct GlyphInstance {
+	float x0, y0, x1, y1;        // Screen rect in pixels
+	uint16_t u0, v0, u1, v1;     // Atlas rect, normalized to 0..65535
+	uint32_t color;              // RGBA8, see packTextColor
+};
+
+// RGBA8 in vertex memory order: red in the lowest byte
+constexpr uint32_t packTextColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+	return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+}
+
+const uint32_t kTextWhite = 0xFFFFFFFFu;
+
+// Color of a string from byte offset start up to the next span
+struct TextColorSpan {
+	size_t start;
+	uint32_t color;
+};
+
+// Axis-aligned screen rectangle in pixels
+struct TextRect {
+	float x0, y0, x1, y1;
+};
+
+// Glyph quads queued during a frame and submitted with a single upload and draw
+struct TextBatch {
+	std::vector<TextVertex> vertices;      // 4 per glyph (TextPipeline::Quads)
+	std::vector<GlyphInstance> instances;  // 1 per glyph (TextPipeline::Instanced)
+	TextPipeline pipeline;                 // Pipeline the queued glyphs were built for
+	TextRect clip;                         // Quads entirely outside are dropped
+	uint32_t color;                        // Color of text queued without spans
+	
+	TextBatch() : pipeline(TextPipeline::Quads), clip({ -FLT_MAX, -FLT_MAX, FLT_MAX, FLT_MAX }), color(kTextWhite) {}
+};
+
+// How a block of lines is placed by buildTextLayout
+enum class TextFlow {
+	Stacked,             // Left aligned at x, one line under the other
+	RightAlignedColumns  // Right aligned at x, wrapping into new columns leftwards at bottomLimit
+};
+
+// Extent of a laid out line at scale 1, relative to its pen origin and baseline
+struct TextLineBox {
+	float advance;         // Pen advance, what right alignment measures
+	float left, right;     // Horizontal ink extent
+	float top, bottom;     // Vertical ink extent (top is negative above the baseline)
+};
+
+struct TextBlock {
+	std::vector<std::string> lines;
+	TextFlow flow;
+	float x, y;            // Left (Stacked) or right (RightAlignedColumns) edge, and first baseline
+	float scale, lineHeight;
+	float bottomLimit;     // RightAlignedColumns only
+	float columnPadding;   // RightAlignedColumns only
+	TextRect clip;         // Lines and glyphs outside are culled; empty (x1 <= x0) means the viewport
+	uint32_t color;        // Color of lines without spans
+	std::vector<std::vector<TextColorSpan>> lineSpans;  // Optional, indexed like lines
+	
+	// Cached by buildTextLayout; clear lineBoxes after editing lines
+	std::vector<TextLineBox> lineBoxes;
+	uint32_t lineBoxGeneration;
+	
+	TextBlock() : flow(TextFlow::Stacked), x(0.0f), y(0.0f), scale(1.0f), lineHeight(0.0f),
+				  bottomLimit(0.0f), columnPadding(0.0f), clip({ 0.0f, 0.0f, 0.0f, 0.0f }),
+				  color(kTextWhite), lineBoxGeneration(0) {}
+};
+
+// A fixed region of a layout's buffer for text that changes often (counters, list rows).
+// Unused glyphs in the region are degenerate, so the layout still draws with one call.
+struct TextSlot {
+	std::string text;      // Current contents; glyphs past maxGlyphs are dropped
+	float x, y, scale;     // Pen origin and scale, like queueText
+	uint32_t color;        // Color of text before the first span
+	std::vector<TextColorSpan> spans;
+	size_t maxGlyphs;      // Glyphs reserved in the buffer
+	size_t base;           // First glyph of the region, set by buildTextLayout
+	
+	TextSlot() : x(0.0f), y(0.0f), scale(1.0f), color(kTextWhite), maxGlyphs(0), base(0) {}
+};
+
+// Retained text: blocks are laid out into glyph geometry once and kept in a static buffer.
+// It is rebuilt only when marked dirty (resize, DPI change) or the glyph pipeline changes.
+// Slots follow the static glyphs and are patched in place by updateTextSlot.
+struct TextLayout {
+	std::vector<TextBlock> blocks;
+	std::vector<TextSlot> slots;
+	TextBatch geometry;       // CPU copy of the last build, capacity reused between builds
+	TextBatch slotGeometry;   // Scratch for slot updates
+	GLuint vao, vbo;
+	size_t glyphCount;        // Static glyphs plus every slot's reserved glyphs
+	TextPipeline pipeline;    // Pipeline the GPU copy was built for
+	int width, height;        // Drawable size the layout was built for
+	uint32_t atlasGeneration; // Glyph cache generation the UVs refer to
+	uint32_t cachePages;      // Glyph cache pages the geometry samples, one bit each
+	bool dirty;
+	
+	TextLayout() : vao(0), vbo(0), glyphCount(0), pipeline(TextPipeline::Quads),
+				   width(0), height(0), atlasGeneration(0), cachePages(0), dirty(true) {}
+};
+
+// Scrollable list of equal-height rows. Only the rows and their height are kept; glyphs are
+// generated for the rows inside the view, so the cost follows the view height, not the row count.
+// The layout holds one slot per visible row, so scrolling rewrites the buffer in place.
+struct TextList {
+	std::vector<std::string> rows;
+	std::vector<std::vector<TextColorSpan>> rowSpans;  // Optional, indexed like rows
+	TextRect view;         // Visible area in pixels; rows are right aligned to view.x1
+	float rowHeight;       // Row i starts at i * rowHeight from the top of the content
+	float baseline;        // Baseline from the top of a row
+	float scale;
+	float scroll;          // Content pixels above the view, a whole number of rows
+	size_t first, last;    // Rows in layout, [first, last)
+	float builtScroll;     // Scroll the layout was built for
+	TextLayout layout;     // One slot per visible row
+	
+	// Cached by updateTextList; clear rowAdvances after editing rows
+	std::vector<float> rowAdvances;  // Pen advance of each row at scale 1, negative until measured
+	uint32_t rowAdvanceGeneration;
+	size_t rowGlyphs;                // Most glyphs any row can produce, the size of each slot
+	
+	TextList() : view({ 0.0f, 0.0f, 0.0f, 0.0f }), rowHeight(1.0f), baseline(0.0f), scale(1.0f),
+				 scroll(0.0f), first(0), last(0), builtScroll(-1.0f), rowAdvanceGeneration(0), rowGlyphs(0) {}
+};
+
+// Overlay text cached in an offscreen RGBA texture (premultiplied alpha). The layer is only
+// redrawn when its content or the drawable size changes; otherwise each frame costs one
+// fullscreen composite instead of re-blending every glyph.
+struct OverlayCompositor {
+	GLuint fbo, texture, vao, program;
+	GLint overlayTextureLoc;
+	int width, height;     // Size of the layer texture
+	bool dirty;
+	bool enabled;
+	
+	OverlayCompositor() : fbo(0), texture(0), vao(0), program(0), overlayTextureLoc(-1),
+						  width(0), height(0), dirty(true), enabled(true) {}
 };
 
 struct CubeRenderer {
@@ -44,8 +630,10 @@ const char* vertexShaderSource = R"(
 #version 330 core
 layout (location = 0) in vec2 aPos;
 layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
 
 out vec2 TexCoord;
+out vec4 TextColor;
 
 uniform vec2 screenSize;
 
@@ -55,6 +643,29 @@ void main() {
 	pos.y = -pos.y; // Flip Y axis
 	gl_Position = vec4(pos, 0.0, 1.0);
 	TexCoord = aTexCoord;
+	TextColor = aColor;
+}
+)";
+
+const char* instancedVertexShaderSource = R"(
+#version 330 core
+layout (location = 0) in vec4 aRect;    // x0, y0, x1, y1 in pixels
+layout (location = 1) in vec4 aUVRect;  // u0, v0, u1, v1
+layout (location = 2) in vec4 aColor;
+
+out vec2 TexCoord;
+out vec4 TextColor;
+
+uniform vec2 screenSize;
+
+void main() {
+	// Triangle strip corners: 0 = (0,0), 1 = (1,0), 2 = (0,1), 3 = (1,1)
+	vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+	vec2 pos = (mix(aRect.xy, aRect.zw, corner) / screenSize) * 2.0 - 1.0;
+	pos.y = -pos.y; // Flip Y axis
+	gl_Position = vec4(pos, 0.0, 1.0);
+	TexCoord = mix(aUVRect.xy, aUVRect.zw, corner);
+	TextColor = aColor;
 }
 )";
 
@@ -63,13 +674,191 @@ const char* fragmentShaderSource = R"(
 out vec4 FragColor;
 
 in vec2 TexCoord;
+in vec4 TextColor;
 
 uniform sampler2D fontTexture;
-uniform vec3 textColor;
 
 void main() {
 	float alpha = texture(fontTexture, TexCoord).r;
-	FragColor = vec4(textColor, alpha);
+	FragColor = vec4(TextColor.rgb, TextColor.a * alpha);
+}
+)";
+
+// Distance field text: fill, outline and drop shadow resolved in one pass. The edge is
+// antialiased over one screen pixel whatever the scale, using the distance derivative.
+const char* sdfFragmentShaderSource = R"(
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+in vec4 TextColor;
+
+uniform sampler2D fontTexture;
+uniform vec4 outlineColor;   // Alpha 0 disables the outline
+uniform float outlineWidth;  // In distance units, 0..0.5
+uniform vec4 shadowColor;    // Alpha 0 disables the shadow
+uniform vec2 shadowOffset;   // In atlas texels
+
+const float edge = 128.0 / 255.0;
+
+void main() {
+	float dist = texture(fontTexture, TexCoord).r;
+	float w = max(fwidth(dist), 1.0 / 255.0);
+	
+	// Composite back to front in premultiplied form: shadow, outline, fill. The branch is on a
+	// uniform, so a disabled shadow skips its sample without divergence.
+	vec4 color = vec4(0.0);
+	if (shadowColor.a > 0.0) {
+		vec2 shadowUV = TexCoord - shadowOffset / vec2(textureSize(fontTexture, 0));
+		float shadowDist = texture(fontTexture, shadowUV).r;
+		float shadow = smoothstep(edge - outlineWidth - w, edge - outlineWidth + w, shadowDist) * shadowColor.a;
+		color = vec4(shadowColor.rgb, 1.0) * shadow;
+	}
+	
+	float outline = smoothstep(edge - outlineWidth - w, edge - outlineWidth + w, dist) * outlineColor.a;
+	color = vec4(outlineColor.rgb, 1.0) * outline + color * (1.0 - outline);
+	
+	float fill = smoothstep(edge - w, edge + w, dist) * TextColor.a;
+	color = vec4(TextColor.rgb, 1.0) * fill + color * (1.0 - fill);
+	
+	// Blending expects straight alpha
+	FragColor = color.a > 0.0 ? vec4(color.rgb / color.a, color.a) : vec4(0.0);
+}
+)";
+
+// Vector text vertex shaders: the UVs carry a GlyphOutlines record index instead of atlas
+// coordinates, and each corner gets its position in the glyph's font units from the record
+const char* vectorVertexShaderSource = R"(
+#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;  // Record index, low and high 16 bits
+layout (location = 2) in vec4 aColor;
+
+out vec2 GlyphPos;
+flat out int Record;
+out vec4 TextColor;
+
+uniform vec2 screenSize;
+uniform samplerBuffer fontTexture;
+
+void main() {
+	vec2 pos = (aPos / screenSize) * 2.0 - 1.0;
+	pos.y = -pos.y; // Flip Y axis
+	gl_Position = vec4(pos, 0.0, 1.0);
+	
+	// Quad corners in pushGlyphQuad order: (x0,y1), (x1,y1), (x1,y0), (x0,y0)
+	int corner = gl_VertexID & 3;
+	Record = int(aTexCoord.x * 65535.0 + 0.5) + (int(aTexCoord.y * 65535.0 + 0.5) << 16);
+	vec4 rect = texelFetch(fontTexture, Record);
+	GlyphPos = mix(rect.xy, rect.zw, vec2(corner == 1 || corner == 2 ? 1.0 : 0.0, corner < 2 ? 1.0 : 0.0));
+	TextColor = aColor;
+}
+)";
+
+const char* vectorInstancedVertexShaderSource = R"(
+#version 330 core
+layout (location = 0) in vec4 aRect;    // x0, y0, x1, y1 in pixels
+layout (location = 1) in vec4 aUVRect;  // Record index, low and high 16 bits, in xy
+layout (location = 2) in vec4 aColor;
+
+out vec2 GlyphPos;
+flat out int Record;
+out vec4 TextColor;
+
+uniform vec2 screenSize;
+uniform samplerBuffer fontTexture;
+
+void main() {
+	// Triangle strip corners: 0 = (0,0), 1 = (1,0), 2 = (0,1), 3 = (1,1)
+	vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+	vec2 pos = (mix(aRect.xy, aRect.zw, corner) / screenSize) * 2.0 - 1.0;
+	pos.y = -pos.y; // Flip Y axis
+	gl_Position = vec4(pos, 0.0, 1.0);
+	
+	Record = int(aUVRect.x * 65535.0 + 0.5) + (int(aUVRect.y * 65535.0 + 0.5) << 16);
+	vec4 rect = texelFetch(fontTexture, Record);
+	GlyphPos = mix(rect.xy, rect.zw, corner);
+	TextColor = aColor;
+}
+)";
+
+// Vector text coverage, after Lengyel's GPU glyph rendering (JCGT 2017). Rays from the pixel
+// center along +x and +y cross every curve of the glyph; the signs of a curve's control points
+// pick which roots count, each crossing adds or removes coverage by how far into the pixel it
+// lies, and the two rays are averaged. The pixel size comes from the derivatives, so the edge
+// stays one pixel wide at any scale.
+const char* vectorFragmentShaderSource = R"(
+#version 330 core
+out vec4 FragColor;
+
+in vec2 GlyphPos;
+flat in int Record;
+in vec4 TextColor;
+
+uniform samplerBuffer fontTexture;
+
+// Signed coverage from the crossings of the +x ray with one curve, points relative to the pixel
+float rayCoverage(vec2 p0, vec2 p1, vec2 p2, float pixelsPerUnit) {
+	uint code = (0x2E74u >> ((p0.y > 0.0 ? 2u : 0u) + (p1.y > 0.0 ? 4u : 0u) + (p2.y > 0.0 ? 8u : 0u))) & 3u;
+	if (code == 0u) return 0.0;
+	
+	vec2 a = p0 - 2.0 * p1 + p2;
+	vec2 b = p0 - p1;
+	float t1, t2;
+	if (abs(a.y) < 1.0e-4) {
+		t1 = t2 = p0.y / (2.0 * b.y);  // Straight in y
+	} else {
+		float d = sqrt(max(b.y * b.y - a.y * p0.y, 0.0));
+		t1 = (b.y - d) / a.y;
+		t2 = (b.y + d) / a.y;
+	}
+	float x1 = (a.x * t1 - 2.0 * b.x) * t1 + p0.x;
+	float x2 = (a.x * t2 - 2.0 * b.x) * t2 + p0.x;
+	
+	float coverage = 0.0;
+	if ((code & 1u) != 0u) coverage += clamp(x1 * pixelsPerUnit + 0.5, 0.0, 1.0);
+	if (code > 1u) coverage -= clamp(x2 * pixelsPerUnit + 0.5, 0.0, 1.0);
+	return coverage;
+}
+
+void main() {
+	vec2 pixelsPerUnit = 1.0 / fwidth(GlyphPos);
+	int curveCount = int(texelFetch(fontTexture, Record + 1).x);
+	float xCoverage = 0.0;
+	float yCoverage = 0.0;
+	for (int i = 0; i < curveCount; i++) {
+		vec4 p01 = texelFetch(fontTexture, Record + 2 + i * 2) - GlyphPos.xyxy;
+		vec2 p2 = texelFetch(fontTexture, Record + 3 + i * 2).xy - GlyphPos;
+		xCoverage += rayCoverage(p01.xy, p01.zw, p2, pixelsPerUnit.x);
+		yCoverage += rayCoverage(p01.yx, p01.wz, p2.yx, pixelsPerUnit.y);  // Axes swapped: the +y ray
+	}
+	float coverage = clamp((abs(xCoverage) + abs(yCoverage)) * 0.5, 0.0, 1.0);
+	FragColor = vec4(TextColor.rgb, TextColor.a * coverage);
+}
+)";
+
+const char* compositeVertexShaderSource = R"(
+#version 330 core
+out vec2 TexCoord;
+
+void main() {
+	// Fullscreen triangle: (0,0), (2,0), (0,2) in texture space
+	vec2 uv = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+	gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+	TexCoord = uv;
+}
+)";
+
+const char* compositeFragmentShaderSource = R"(
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D overlayTexture;
+
+void main() {
+	FragColor = texture(overlayTexture, TexCoord);
 }
 )";
 
@@ -97,580 +886,2522 @@ void main() {
 }
 )";
 
-void setPixel(unsigned char* fontData, int textureWidth, int startX, int startY, int x, int y) {
-	int pixelX = startX + x;
-	int pixelY = startY + y;
-	int idx = pixelY * textureWidth + pixelX;
-	fontData[idx] = 255;
-}
+// Fallback 8x8 font for printable ASCII (32..126): one byte per row, bit x set for column x.
+// Lowercase letters reuse the capitals and anything without a design is drawn as a box.
+constexpr unsigned char kBitmapFontGlyphs[95][8] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // ' '
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '!'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '"'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '#'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '$'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '%'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '&'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '\''
+	{ 0x00, 0x08, 0x04, 0x04, 0x04, 0x04, 0x08, 0x00 },  // '('
+	{ 0x00, 0x10, 0x20, 0x20, 0x20, 0x20, 0x10, 0x00 },  // ')'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '*'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '+'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // ','
+	{ 0x00, 0x00, 0x00, 0x3C, 0x00, 0x00, 0x00, 0x00 },  // '-'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x00 },  // '.'
+	{ 0x00, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 },  // '/'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '0'
+	{ 0x00, 0x0C, 0x08, 0x08, 0x08, 0x08, 0x0C, 0x00 },  // '1'
+	{ 0x00, 0x7E, 0x40, 0x40, 0x7E, 0x02, 0x7E, 0x00 },  // '2'
+	{ 0x00, 0x7E, 0x40, 0x40, 0x7E, 0x40, 0x7E, 0x00 },  // '3'
+	{ 0x00, 0x42, 0x42, 0x42, 0x7E, 0x40, 0x40, 0x00 },  // '4'
+	{ 0x00, 0x7E, 0x02, 0x7E, 0x40, 0x40, 0x7E, 0x00 },  // '5'
+	{ 0x00, 0x7E, 0x02, 0x02, 0x7E, 0x42, 0x7E, 0x00 },  // '6'
+	{ 0x00, 0x7E, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00 },  // '7'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x7E, 0x42, 0x7E, 0x00 },  // '8'
+	{ 0x00, 0x7E, 0x40, 0x40, 0x7E, 0x02, 0x7E, 0x00 },  // '9'
+	{ 0x00, 0x00, 0x08, 0x00, 0x00, 0x08, 0x00, 0x00 },  // ':'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // ';'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '<'
+	{ 0x00, 0x00, 0x7E, 0x00, 0x00, 0x7E, 0x00, 0x00 },  // '='
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '>'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '?'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '@'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x7E, 0x42, 0x42, 0x00 },  // 'A'
+	{ 0x00, 0x3E, 0x42, 0x42, 0x3E, 0x42, 0x3E, 0x00 },  // 'B'
+	{ 0x00, 0x3C, 0x02, 0x02, 0x02, 0x02, 0x3C, 0x00 },  // 'C'
+	{ 0x00, 0x3E, 0x42, 0x42, 0x42, 0x42, 0x3E, 0x00 },  // 'D'
+	{ 0x00, 0x7E, 0x02, 0x02, 0x7E, 0x02, 0x7E, 0x00 },  // 'E'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'F'
+	{ 0x00, 0x3C, 0x02, 0x02, 0x62, 0x42, 0x3C, 0x00 },  // 'G'
+	{ 0x00, 0x42, 0x42, 0x42, 0x7E, 0x42, 0x42, 0x00 },  // 'H'
+	{ 0x00, 0x7E, 0x08, 0x08, 0x08, 0x08, 0x7E, 0x00 },  // 'I'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'J'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'K'
+	{ 0x00, 0x02, 0x02, 0x02, 0x02, 0x02, 0x7E, 0x00 },  // 'L'
+	{ 0x00, 0x42, 0x66, 0x5A, 0x42, 0x42, 0x42, 0x00 },  // 'M'
+	{ 0x00, 0x42, 0x46, 0x4A, 0x52, 0x62, 0x42, 0x00 },  // 'N'
+	{ 0x00, 0x3C, 0x42, 0x42, 0x42, 0x42, 0x3C, 0x00 },  // 'O'
+	{ 0x00, 0x3E, 0x42, 0x42, 0x3E, 0x02, 0x02, 0x00 },  // 'P'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'Q'
+	{ 0x00, 0x3E, 0x42, 0x42, 0x3E, 0x22, 0x42, 0x00 },  // 'R'
+	{ 0x00, 0x7E, 0x02, 0x02, 0x7E, 0x40, 0x7E, 0x00 },  // 'S'
+	{ 0x00, 0x7E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00 },  // 'T'
+	{ 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'U'
+	{ 0x00, 0x42, 0x42, 0x42, 0x42, 0x24, 0x18, 0x00 },  // 'V'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'W'
+	{ 0x00, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x00 },  // 'X'
+	{ 0x00, 0x18, 0x24, 0x24, 0x3C, 0x08, 0x08, 0x00 },  // 'Y'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'Z'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '['
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '\\'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // ']'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '^'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '_'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '`'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x7E, 0x42, 0x42, 0x00 },  // 'a'
+	{ 0x00, 0x3E, 0x42, 0x42, 0x3E, 0x42, 0x3E, 0x00 },  // 'b'
+	{ 0x00, 0x3C, 0x02, 0x02, 0x02, 0x02, 0x3C, 0x00 },  // 'c'
+	{ 0x00, 0x3E, 0x42, 0x42, 0x42, 0x42, 0x3E, 0x00 },  // 'd'
+	{ 0x00, 0x7E, 0x02, 0x02, 0x7E, 0x02, 0x7E, 0x00 },  // 'e'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'f'
+	{ 0x00, 0x3C, 0x02, 0x02, 0x62, 0x42, 0x3C, 0x00 },  // 'g'
+	{ 0x00, 0x42, 0x42, 0x42, 0x7E, 0x42, 0x42, 0x00 },  // 'h'
+	{ 0x00, 0x7E, 0x08, 0x08, 0x08, 0x08, 0x7E, 0x00 },  // 'i'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'j'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'k'
+	{ 0x00, 0x02, 0x02, 0x02, 0x02, 0x02, 0x7E, 0x00 },  // 'l'
+	{ 0x00, 0x42, 0x66, 0x5A, 0x42, 0x42, 0x42, 0x00 },  // 'm'
+	{ 0x00, 0x42, 0x46, 0x4A, 0x52, 0x62, 0x42, 0x00 },  // 'n'
+	{ 0x00, 0x3C, 0x42, 0x42, 0x42, 0x42, 0x3C, 0x00 },  // 'o'
+	{ 0x00, 0x3E, 0x42, 0x42, 0x3E, 0x02, 0x02, 0x00 },  // 'p'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'q'
+	{ 0x00, 0x3E, 0x42, 0x42, 0x3E, 0x22, 0x42, 0x00 },  // 'r'
+	{ 0x00, 0x7E, 0x02, 0x02, 0x7E, 0x40, 0x7E, 0x00 },  // 's'
+	{ 0x00, 0x7E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00 },  // 't'
+	{ 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'u'
+	{ 0x00, 0x42, 0x42, 0x42, 0x42, 0x24, 0x18, 0x00 },  // 'v'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'w'
+	{ 0x00, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x00 },  // 'x'
+	{ 0x00, 0x18, 0x24, 0x24, 0x3C, 0x08, 0x08, 0x00 },  // 'y'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // 'z'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '{'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '|'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 },  // '}'
+	{ 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00 }   // '~'
+};
 
-void drawChar(unsigned char* fontData, int textureWidth, int startX, int startY, unsigned char c) {
-	
-	switch (c) {
-		case ' ': break;
-		case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
-			if (c == '0') {
-				for (int y = 1; y < 7; y++) {
-					setPixel(fontData, textureWidth, startX, startY, 1, y);
-					setPixel(fontData, textureWidth, startX, startY, 6, y);
-				}
-				for (int x = 1; x < 7; x++) {
-					setPixel(fontData, textureWidth, startX, startY, x, 1);
-					setPixel(fontData, textureWidth, startX, startY, x, 6);
-				}
-			} else if (c == '1') {
-				for (int y = 1; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 3, y);
-				setPixel(fontData, textureWidth, startX, startY, 2, 1);
-				setPixel(fontData, textureWidth, startX, startY, 2, 6);
-			} else if (c == '2') {
-				for (int x = 1; x < 7; x++) {
-					setPixel(fontData, textureWidth, startX, startY, x, 1);
-					setPixel(fontData, textureWidth, startX, startY, x, 4);
-					setPixel(fontData, textureWidth, startX, startY, x, 6);
-				}
-				setPixel(fontData, textureWidth, startX, startY, 6, 2);
-				setPixel(fontData, textureWidth, startX, startY, 6, 3);
-				setPixel(fontData, textureWidth, startX, startY, 1, 4);
-				setPixel(fontData, textureWidth, startX, startY, 1, 5);
-			} else if (c == '3') {
-				for (int x = 1; x < 7; x++) {
-					setPixel(fontData, textureWidth, startX, startY, x, 1);
-					setPixel(fontData, textureWidth, startX, startY, x, 4);
-					setPixel(fontData, textureWidth, startX, startY, x, 6);
-				}
-				for (int y = 2; y < 4; y++) setPixel(fontData, textureWidth, startX, startY, 6, y);
-				for (int y = 4; y < 6; y++) setPixel(fontData, textureWidth, startX, startY, 6, y);
-			} else if (c == '4') {
-				for (int y = 1; y < 5; y++) setPixel(fontData, textureWidth, startX, startY, 1, y);
-				for (int x = 1; x < 7; x++) setPixel(fontData, textureWidth, startX, startY, x, 4);
-				for (int y = 1; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 6, y);
-			} else if (c == '5') {
-				for (int x = 1; x < 7; x++) {
-					setPixel(fontData, textureWidth, startX, startY, x, 1);
-					setPixel(fontData, textureWidth, startX, startY, x, 3);
-					setPixel(fontData, textureWidth, startX, startY, x, 6);
-				}
-				setPixel(fontData, textureWidth, startX, startY, 1, 2);
-				for (int y = 4; y < 6; y++) setPixel(fontData, textureWidth, startX, startY, 6, y);
-			} else if (c == '6') {
-				for (int y = 1; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 1, y);
-				for (int x = 1; x < 7; x++) {
-					setPixel(fontData, textureWidth, startX, startY, x, 1);
-					setPixel(fontData, textureWidth, startX, startY, x, 4);
-					setPixel(fontData, textureWidth, startX, startY, x, 6);
-				}
-				for (int y = 4; y < 6; y++) setPixel(fontData, textureWidth, startX, startY, 6, y);
-			} else if (c == '7') {
-				for (int x = 1; x < 7; x++) setPixel(fontData, textureWidth, startX, startY, x, 1);
-				for (int y = 2; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 6, y);
-			} else if (c == '8') {
-				for (int y = 1; y < 7; y++) {
-					setPixel(fontData, textureWidth, startX, startY, 1, y);
-					setPixel(fontData, textureWidth, startX, startY, 6, y);
-				}
-				for (int x = 1; x < 7; x++) {
-					setPixel(fontData, textureWidth, startX, startY, x, 1);
-					setPixel(fontData, textureWidth, startX, startY, x, 4);
-					setPixel(fontData, textureWidth, startX, startY, x, 6);
-				}
-			} else if (c == '9') {
-				for (int y = 1; y < 5; y++) setPixel(fontData, textureWidth, startX, startY, 6, y);
-				for (int x = 1; x < 7; x++) {
-					setPixel(fontData, textureWidth, startX, startY, x, 1);
-					setPixel(fontData, textureWidth, startX, startY, x, 4);
-					setPixel(fontData, textureWidth, startX, startY, x, 6);
+const int kBitmapFontTextureWidth = 128;  // 16 cells of 8 px per row
+const int kBitmapFontTextureHeight = 64;  // 8 rows of cells, 6 used
+
+struct BitmapFontImage {
+	unsigned char pixels[kBitmapFontTextureWidth * kBitmapFontTextureHeight];
+};
+
+// Expand the bit table into the texture image; evaluated by the compiler
+constexpr BitmapFontImage makeBitmapFontImage() {
+	BitmapFontImage image = {};
+	for (int i = 0; i < 95; i++) {
+		int startX = (i % 16) * 8;
+		int startY = (i / 16) * 8;
+		for (int y = 0; y < 8; y++) {
+			for (int x = 0; x < 8; x++) {
+				if (kBitmapFontGlyphs[i][y] & (1 << x)) {
+					image.pixels[(startY + y) * kBitmapFontTextureWidth + startX + x] = 255;
 				}
-				for (int y = 4; y < 6; y++) setPixel(fontData, textureWidth, startX, startY, 1, y);
 			}
+		}
+	}
+	return image;
+}
+
+static constexpr BitmapFontImage kBitmapFontImage = makeBitmapFontImage();
+
+// Copy one bitmap row. Glyph rows are short (8..64 bytes), so 16-byte moves with an
+// overlapping tail beat a memcpy call per row.
+static inline void copyAtlasRow(unsigned char* dst, const unsigned char* src, size_t n) {
+#if defined(TEXT_SIMD_SSE2)
+	if (n >= 16) {
+		size_t i = 0;
+		for (; i + 16 <= n; i += 16) {
+			_mm_storeu_si128((__m128i*)(dst + i), _mm_loadu_si128((const __m128i*)(src + i)));
+		}
+		if (i < n) {
+			_mm_storeu_si128((__m128i*)(dst + n - 16), _mm_loadu_si128((const __m128i*)(src + n - 16)));
+		}
+		return;
+	}
+#elif defined(TEXT_SIMD_NEON)
+	if (n >= 16) {
+		size_t i = 0;
+		for (; i + 16 <= n; i += 16) {
+			vst1q_u8(dst + i, vld1q_u8(src + i));
+		}
+		if (i < n) {
+			vst1q_u8(dst + n - 16, vld1q_u8(src + n - 16));
+		}
+		return;
+	}
+#endif
+	memcpy(dst, src, n);
+}
+
+// Copy a w x h 8-bit bitmap to (x, y) of a dstWidth x dstHeight image. The rect is clipped
+// once up front, so rows are copied whole. Shared by the baked atlas and the glyph cache.
+void blitAtlasRect(unsigned char* dst, int dstWidth, int dstHeight, int x, int y,
+				   const unsigned char* src, int srcStride, int w, int h) {
+	int x0 = std::max(x, 0);
+	int y0 = std::max(y, 0);
+	int x1 = std::min(x + w, dstWidth);
+	int y1 = std::min(y + h, dstHeight);
+	if (x0 >= x1 || y0 >= y1) return;
+	
+	size_t rowBytes = (size_t)(x1 - x0);
+	src += (size_t)(y0 - y) * srcStride + (x0 - x);
+	dst += (size_t)y0 * dstWidth + x0;
+	for (int row = y0; row < y1; row++) {
+		copyAtlasRow(dst, src, rowBytes);
+		src += srcStride;
+		dst += dstWidth;
+	}
+}
+
+// One row of a 2x2 box filter: dst[i] is the rounded mean of the pairs at 2i in row0 and row1
+static inline void downsampleAtlasRow(unsigned char* dst, const unsigned char* row0, const unsigned char* row1, size_t n) {
+	size_t i = 0;
+#if defined(TEXT_SIMD_SSE2)
+	// Split even and odd bytes into 16-bit lanes, sum the four, round and pack back
+	const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+	const __m128i two = _mm_set1_epi16(2);
+	for (; i + 16 <= n; i += 16) {
+		__m128i halves[2];
+		for (int h = 0; h < 2; h++) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(row0 + 2 * i + 16 * h));
+			__m128i b = _mm_loadu_si128((const __m128i*)(row1 + 2 * i + 16 * h));
+			__m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a, lowBytes), _mm_srli_epi16(a, 8)),
+										_mm_add_epi16(_mm_and_si128(b, lowBytes), _mm_srli_epi16(b, 8)));
+			halves[h] = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+		}
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(halves[0], halves[1]));
+	}
+#elif defined(TEXT_SIMD_NEON)
+	// Pairwise widening adds of both rows, then a rounding narrow by 4
+	for (; i + 16 <= n; i += 16) {
+		uint16x8_t lo = vpadalq_u8(vpaddlq_u8(vld1q_u8(row0 + 2 * i)), vld1q_u8(row1 + 2 * i));
+		uint16x8_t hi = vpadalq_u8(vpaddlq_u8(vld1q_u8(row0 + 2 * i + 16)), vld1q_u8(row1 + 2 * i + 16));
+		vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i] = (unsigned char)((row0[2 * i] + row0[2 * i + 1] + row1[2 * i] + row1[2 * i + 1] + 2) >> 2);
+	}
+}
+
+// Box filter a 2w x 2h region of src down to w x h at dst
+void downsampleAtlasRect(unsigned char* dst, int dstStride, const unsigned char* src, int srcStride, int w, int h) {
+	for (int y = 0; y < h; y++) {
+		const unsigned char* row0 = src + (size_t)(2 * y) * srcStride;
+		downsampleAtlasRow(dst + (size_t)y * dstStride, row0, row0 + srcStride, (size_t)w);
+	}
+}
+
+// Grow a width x height image into its mip chain (see atlasMipChainSize)
+void buildAtlasMips(std::vector<unsigned char>& pixels, int width, int height) {
+	pixels.resize(atlasMipChainSize(width, height));
+	size_t offset = 0;
+	for (int level = 1; level < kAtlasMipLevels; level++) {
+		int srcWidth = width >> (level - 1);
+		int srcHeight = height >> (level - 1);
+		size_t next = offset + (size_t)srcWidth * srcHeight;
+		downsampleAtlasRect(&pixels[next], srcWidth / 2, &pixels[offset], srcWidth, srcWidth / 2, srcHeight / 2);
+		offset = next;
+	}
+}
+
+void initGlyphCache(GlyphCache& cache, int width, int originY, int pageHeight) {
+	cache.originY = originY;
+	cache.width = width;
+	cache.height = pageHeight * kGlyphCachePages;
+	cache.pixels.assign((size_t)cache.width * cache.height, 0);
+	for (int p = 0; p < kGlyphCachePages; p++) {
+		resetSkyline(cache.pages[p].packer, width, pageHeight);
+		cache.pages[p].codepoints.clear();
+		cache.pages[p].lastUsed = 0;
+	}
+	cache.dirtyX0 = cache.dirtyX1 = 0;
+	cache.dirtyY0 = cache.dirtyY1 = 0;
+}
+
+// Grow the rect waiting for upload to include x0..x1, y0..y1 (cache coordinates)
+static void markGlyphCacheDirty(GlyphCache& cache, int x0, int y0, int x1, int y1) {
+	if (cache.dirtyX0 >= cache.dirtyX1) {
+		cache.dirtyX0 = x0; cache.dirtyY0 = y0;
+		cache.dirtyX1 = x1; cache.dirtyY1 = y1;
+	} else {
+		cache.dirtyX0 = std::min(cache.dirtyX0, x0);
+		cache.dirtyY0 = std::min(cache.dirtyY0, y0);
+		cache.dirtyX1 = std::max(cache.dirtyX1, x1);
+		cache.dirtyY1 = std::max(cache.dirtyY1, y1);
+	}
+}
+
+// Find room for a w x h rect, evicting the least recently used page not sampled this frame.
+// An evicted page is cleared and uploaded whole, so gutters never keep texels of old glyphs.
+static bool allocateGlyphCacheRect(TextRenderer& renderer, int w, int h, int& page, int& x, int& y) {
+	GlyphCache& cache = renderer.glyphCache;
+	for (int p = 0; p < kGlyphCachePages; p++) {
+		if (skylineInsert(cache.pages[p].packer, w, h, x, y)) {
+			page = p;
+			return true;
+		}
+	}
+	
+	int victim = -1;
+	for (int p = 0; p < kGlyphCachePages; p++) {
+		if (cache.pages[p].lastUsed >= renderer.frame) continue;
+		if (victim < 0 || cache.pages[p].lastUsed < cache.pages[victim].lastUsed) victim = p;
+	}
+	if (victim < 0) return false;
+	
+	GlyphCachePage& evicted = cache.pages[victim];
+	for (uint32_t codepoint : evicted.codepoints) {
+		eraseGlyph(renderer.glyphs, codepoint);
+	}
+	evicted.codepoints.clear();
+	resetSkyline(evicted.packer, evicted.packer.width, evicted.packer.height);
+	int pageY = victim * evicted.packer.height;
+	memset(&cache.pixels[(size_t)pageY * cache.width], 0, (size_t)evicted.packer.height * cache.width);
+	markGlyphCacheDirty(cache, 0, pageY, cache.width, pageY + evicted.packer.height);
+	cache.generation++;
+	
+	if (!skylineInsert(evicted.packer, w, h, x, y)) return false;
+	page = victim;
+	return true;
+}
+
+// Append a glyph rasterized in the given atlas mode to strip. Distance fields get one
+// cell; coverage gets subpixelPhases cells (see glyphStripWidth), cell p shifted right by
+// p / subpixelPhases of a pixel. width and the offsets describe one cell, sized to fit every
+// phase. Returns false, appending nothing, for blank glyphs.
+bool rasterizeGlyph(const stbtt_fontinfo& font, float scale, int glyphIndex, AtlasMode mode, int subpixelPhases,
+					std::vector<unsigned char>& strip, int& width, int& height, int& xoff, int& yoff) {
+	width = height = xoff = yoff = 0;
+	if (mode == AtlasMode::DistanceField) {
+		unsigned char* sdf = stbtt_GetGlyphSDF(&font, scale, glyphIndex, kSdfPadding, kSdfOnEdge, kSdfPixelDistScale,
+											   &width, &height, &xoff, &yoff);
+		if (!sdf) return false;
+		strip.insert(strip.end(), sdf, sdf + (size_t)width * height);
+		stbtt_FreeSDF(sdf, NULL);
+		return true;
+	}
+	
+	int x0, y0, x1, y1;
+	stbtt_GetGlyphBitmapBoxSubpixel(&font, glyphIndex, scale, scale, 0.0f, 0.0f, &x0, &y0, &x1, &y1);
+	for (int phase = 1; phase < subpixelPhases; phase++) {
+		int px0, py0, px1, py1;
+		float shift = (float)phase / (float)subpixelPhases;
+		stbtt_GetGlyphBitmapBoxSubpixel(&font, glyphIndex, scale, scale, shift, 0.0f, &px0, &py0, &px1, &py1);
+		x0 = std::min(x0, px0);
+		x1 = std::max(x1, px1);
+	}
+	if (x1 <= x0 || y1 <= y0) return false;
+	
+	width = x1 - x0;
+	height = y1 - y0;
+	xoff = x0;
+	yoff = y0;
+	int stride = glyphStripWidth(width, subpixelPhases);
+	size_t base = strip.size();
+	strip.resize(base + (size_t)stride * height, 0);
+	for (int phase = 0; phase < subpixelPhases; phase++) {
+		int px0, py0, px1, py1;
+		float shift = (float)phase / (float)subpixelPhases;
+		stbtt_GetGlyphBitmapBoxSubpixel(&font, glyphIndex, scale, scale, shift, 0.0f, &px0, &py0, &px1, &py1);
+		unsigned char* cell = &strip[base + (size_t)(py0 - y0) * stride + phase * glyphCellStride(width) + (px0 - x0)];
+		stbtt_MakeGlyphBitmapSubpixel(&font, cell, px1 - px0, py1 - py0, stride, scale, scale, shift, 0.0f, glyphIndex);
+	}
+	return true;
+}
+
+// One quadratic curve of an outline record: (p0, p1) and (p2, unused) as two texels
+static void appendOutlineCurve(std::vector<float>& texels, float x0, float y0, float x1, float y1, float x2, float y2) {
+	const float curve[8] = { x0, y0, x1, y1, x2, y2, 0.0f, 0.0f };
+	texels.insert(texels.end(), curve, curve + 8);
+}
+
+// Append the outline record of a glyph to texels, in font units with y up:
+//   texel 0   glyph quad corners (x0, y0) top left and (x1, y1) bottom right
+//   texel 1   curve count in x
+//   then two texels per quadratic curve, see appendOutlineCurve
+// Lines become quadratics with the control point at their middle; CFF cubics are split in
+// half and each half approximated by one quadratic. width, height and the offsets give the
+// quad in pixels at scale, with a pixel of margin for antialiasing. Returns false,
+// appending nothing, for blank glyphs.
+bool appendGlyphOutline(const stbtt_fontinfo& font, float scale, int glyphIndex, std::vector<float>& texels,
+						int& width, int& height, int& xoff, int& yoff) {
+	width = height = xoff = yoff = 0;
+	stbtt_vertex* vertices;
+	int vertexCount = stbtt_GetGlyphShape(&font, glyphIndex, &vertices);
+	int bx0, by0, bx1, by1;
+	if (vertexCount <= 0 || !stbtt_GetGlyphBox(&font, glyphIndex, &bx0, &by0, &bx1, &by1)) {
+		stbtt_FreeShape(&font, vertices);
+		return false;
+	}
+	
+	xoff = (int)floorf(bx0 * scale) - 1;
+	yoff = (int)floorf(-by1 * scale) - 1;
+	width = (int)ceilf(bx1 * scale) + 1 - xoff;
+	height = (int)ceilf(-by0 * scale) + 1 - yoff;
+	
+	size_t record = texels.size();
+	const float header[8] = { xoff / scale, -yoff / scale, (xoff + width) / scale, -(yoff + height) / scale,
+							  0.0f, 0.0f, 0.0f, 0.0f };
+	texels.insert(texels.end(), header, header + 8);
+	
+	float x = 0.0f, y = 0.0f;
+	for (int i = 0; i < vertexCount; i++) {
+		const stbtt_vertex& v = vertices[i];
+		switch (v.type) {
+		case STBTT_vline:
+			appendOutlineCurve(texels, x, y, (x + v.x) * 0.5f, (y + v.y) * 0.5f, v.x, v.y);
 			break;
-		case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G': case 'H': case 'I': case 'J':
-		case 'K': case 'L': case 'M': case 'N': case 'O': case 'P': case 'Q': case 'R': case 'S': case 'T':
-		case 'U': case 'V': case 'W': case 'X': case 'Y': case 'Z':
-			if (c >= 'A' && c <= 'Z') {
-				if (c == 'A') {
-					for (int y = 2; y < 7; y++) {
-						setPixel(fontData, textureWidth, startX, startY, 1, y);
-						setPixel(fontData, textureWidth, startX, startY, 6, y);
-					}
-					for (int x = 1; x < 7; x++) setPixel(fontData, textureWidth, startX, startY, x, 1);
-					for (int x = 2; x < 6; x++) setPixel(fontData, textureWidth, startX, startY, x, 4);
-				} else if (c == 'B') {
-					for (int y = 1; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 1, y);
-					for (int x = 1; x < 6; x++) {
-						setPixel(fontData, textureWidth, startX, startY, x, 1);
-						setPixel(fontData, textureWidth, startX, startY, x, 4);
-						setPixel(fontData, textureWidth, startX, startY, x, 6);
-					}
-					setPixel(fontData, textureWidth, startX, startY, 6, 2);
-					setPixel(fontData, textureWidth, startX, startY, 6, 3);
-					setPixel(fontData, textureWidth, startX, startY, 6, 5);
-				} else if (c == 'C') {
-					for (int y = 2; y < 6; y++) setPixel(fontData, textureWidth, startX, startY, 1, y);
-					for (int x = 2; x < 6; x++) {
-						setPixel(fontData, textureWidth, startX, startY, x, 1);
-						setPixel(fontData, textureWidth, startX, startY, x, 6);
-					}
-				} else if (c == 'D') {
-					for (int y = 1; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 1, y);
-					for (int y = 2; y < 6; y++) setPixel(fontData, textureWidth, startX, startY, 6, y);
-					setPixel(fontData, textureWidth, startX, startY, 2, 1);
-					setPixel(fontData, textureWidth, startX, startY, 3, 1);
-					setPixel(fontData, textureWidth, startX, startY, 4, 1);
-					setPixel(fontData, textureWidth, startX, startY, 5, 1);
-					setPixel(fontData, textureWidth, startX, startY, 2, 6);
-					setPixel(fontData, textureWidth, startX, startY, 3, 6);
-					setPixel(fontData, textureWidth, startX, startY, 4, 6);
-					setPixel(fontData, textureWidth, startX, startY, 5, 6);
-				} else if (c == 'E') {
-					for (int y = 1; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 1, y);
-					for (int x = 1; x < 7; x++) {
-						setPixel(fontData, textureWidth, startX, startY, x, 1);
-						setPixel(fontData, textureWidth, startX, startY, x, 4);
-						setPixel(fontData, textureWidth, startX, startY, x, 6);
-					}
-				} else if (c == 'G') {
-					for (int y = 2; y < 6; y++) setPixel(fontData, textureWidth, startX, startY, 1, y);
-					for (int x = 2; x < 6; x++) {
-						setPixel(fontData, textureWidth, startX, startY, x, 1);
-						setPixel(fontData, textureWidth, startX, startY, x, 6);
-					}
-					setPixel(fontData, textureWidth, startX, startY, 6, 4);
-					setPixel(fontData, textureWidth, startX, startY, 6, 5);
-					setPixel(fontData, textureWidth, startX, startY, 5, 4);
-				} else if (c == 'H') {
-					for (int y = 1; y < 7; y++) {
-						setPixel(fontData, textureWidth, startX, startY, 1, y);
-						setPixel(fontData, textureWidth, startX, startY, 6, y);
-					}
-					for (int x = 1; x < 7; x++) setPixel(fontData, textureWidth, startX, startY, x, 4);
-				} else if (c == 'I') {
-					for (int y = 1; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 3, y);
-					for (int x = 1; x < 7; x++) {
-						setPixel(fontData, textureWidth, startX, startY, x, 1);
-						setPixel(fontData, textureWidth, startX, startY, x, 6);
-					}
-				} else if (c == 'L') {
-					for (int y = 1; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 1, y);
-					for (int x = 1; x < 7; x++) setPixel(fontData, textureWidth, startX, startY, x, 6);
-				} else if (c == 'M') {
-					for (int y = 1; y < 7; y++) {
-						setPixel(fontData, textureWidth, startX, startY, 1, y);
-						setPixel(fontData, textureWidth, startX, startY, 6, y);
-					}
-					setPixel(fontData, textureWidth, startX, startY, 2, 2);
-					setPixel(fontData, textureWidth, startX, startY, 3, 3);
-					setPixel(fontData, textureWidth, startX, startY, 4, 3);
-					setPixel(fontData, textureWidth, startX, startY, 5, 2);
-				} else if (c == 'N') {
-					for (int y = 1; y < 7; y++) {
-						setPixel(fontData, textureWidth, startX, startY, 1, y);
-						setPixel(fontData, textureWidth, startX, startY, 6, y);
-					}
-					setPixel(fontData, textureWidth, startX, startY, 2, 2);
-					setPixel(fontData, textureWidth, startX, startY, 3, 3);
-					setPixel(fontData, textureWidth, startX, startY, 4, 4);
-					setPixel(fontData, textureWidth, startX, startY, 5, 5);
-				} else if (c == 'O') {
-					for (int y = 2; y < 6; y++) {
-						setPixel(fontData, textureWidth, startX, startY, 1, y);
-						setPixel(fontData, textureWidth, startX, startY, 6, y);
-					}
-					for (int x = 2; x < 6; x++) {
-						setPixel(fontData, textureWidth, startX, startY, x, 1);
-						setPixel(fontData, textureWidth, startX, startY, x, 6);
-					}
-				} else if (c == 'P') {
-					for (int y = 1; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 1, y);
-					for (int x = 1; x < 6; x++) {
-						setPixel(fontData, textureWidth, startX, startY, x, 1);
-						setPixel(fontData, textureWidth, startX, startY, x, 4);
-					}
-					setPixel(fontData, textureWidth, startX, startY, 6, 2);
-					setPixel(fontData, textureWidth, startX, startY, 6, 3);
-				} else if (c == 'R') {
-					for (int y = 1; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 1, y);
-					for (int x = 1; x < 6; x++) {
-						setPixel(fontData, textureWidth, startX, startY, x, 1);
-						setPixel(fontData, textureWidth, startX, startY, x, 4);
-					}
-					setPixel(fontData, textureWidth, startX, startY, 6, 2);
-					setPixel(fontData, textureWidth, startX, startY, 6, 3);
-					setPixel(fontData, textureWidth, startX, startY, 5, 5);
-					setPixel(fontData, textureWidth, startX, startY, 6, 6);
-				} else if (c == 'S') {
-					for (int x = 1; x < 7; x++) {
-						setPixel(fontData, textureWidth, startX, startY, x, 1);
-						setPixel(fontData, textureWidth, startX, startY, x, 4);
-						setPixel(fontData, textureWidth, startX, startY, x, 6);
-					}
-					setPixel(fontData, textureWidth, startX, startY, 1, 2);
-					setPixel(fontData, textureWidth, startX, startY, 1, 3);
-					setPixel(fontData, textureWidth, startX, startY, 6, 5);
-				} else if (c == 'T') {
-					for (int x = 1; x < 7; x++) setPixel(fontData, textureWidth, startX, startY, x, 1);
-					for (int y = 1; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 3, y);
-				} else if (c == 'U') {
-					for (int y = 1; y < 6; y++) {
-						setPixel(fontData, textureWidth, startX, startY, 1, y);
-						setPixel(fontData, textureWidth, startX, startY, 6, y);
-					}
-					for (int x = 1; x < 7; x++) setPixel(fontData, textureWidth, startX, startY, x, 6);
-				} else if (c == 'V') {
-					for (int y = 1; y < 5; y++) {
-						setPixel(fontData, textureWidth, startX, startY, 1, y);
-						setPixel(fontData, textureWidth, startX, startY, 6, y);
-					}
-					setPixel(fontData, textureWidth, startX, startY, 2, 5);
-					setPixel(fontData, textureWidth, startX, startY, 5, 5);
-					setPixel(fontData, textureWidth, startX, startY, 3, 6);
-					setPixel(fontData, textureWidth, startX, startY, 4, 6);
-				} else if (c == 'X') {
-					for (int i = 0; i < 6; i++) {
-						setPixel(fontData, textureWidth, startX, startY, 1 + i, 1 + i);
-						setPixel(fontData, textureWidth, startX, startY, 6 - i, 1 + i);
-					}
-				} else if (c == 'Y') {
-					setPixel(fontData, textureWidth, startX, startY, 3, 1);
-					setPixel(fontData, textureWidth, startX, startY, 4, 1);
-					for (int y = 2; y < 5; y++) {
-						setPixel(fontData, textureWidth, startX, startY, 2, y);
-						setPixel(fontData, textureWidth, startX, startY, 5, y);
-					}
-					for (int y = 4; y < 7; y++) setPixel(fontData, textureWidth, startX, startY, 3, y);
-					setPixel(fontData, textureWidth, startX, startY, 4, 4);
-				} else {
-					for (int y = 1; y < 7; y++) {
-						setPixel(fontData, textureWidth, startX, startY, 1, y);
-						setPixel(fontData, textureWidth, startX, startY, 6, y);
-					}
-					for (int x = 1; x < 7; x++) {
-						setPixel(fontData, textureWidth, startX, startY, x, 1);
-						setPixel(fontData, textureWidth, startX, startY, x, 6);
-					}
-				}
-			}
-			break;
-		case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g': case 'h': case 'i': case 'j':
-		case 'k': case 'l': case 'm': case 'n': case 'o': case 'p': case 'q': case 'r': case 's': case 't':
-		case 'u': case 'v': case 'w': case 'x': case 'y': case 'z':
-			drawChar(fontData, textureWidth, startX, startY, c - 32);
-			break;
-		case ':':
-			setPixel(fontData, textureWidth, startX, startY, 3, 2);
-			setPixel(fontData, textureWidth, startX, startY, 3, 5);
-			break;
-		case '.':
-			setPixel(fontData, textureWidth, startX, startY, 3, 6);
-			setPixel(fontData, textureWidth, startX, startY, 4, 6);
+		case STBTT_vcurve:
+			appendOutlineCurve(texels, x, y, v.cx, v.cy, v.x, v.y);
 			break;
-		case '-':
-			for (int x = 2; x < 6; x++) setPixel(fontData, textureWidth, startX, startY, x, 3);
+		case STBTT_vcubic: {
+			// de Casteljau at t = 0.5, then each half's quadratic control is (3 (c1 + c2) - p0 - p3) / 4
+			float ax = (x + v.cx) * 0.5f, ay = (y + v.cy) * 0.5f;
+			float bx = (v.cx + v.cx1) * 0.5f, by = (v.cy + v.cy1) * 0.5f;
+			float cx = (v.cx1 + v.x) * 0.5f, cy = (v.cy1 + v.y) * 0.5f;
+			float abx = (ax + bx) * 0.5f, aby = (ay + by) * 0.5f;
+			float bcx = (bx + cx) * 0.5f, bcy = (by + cy) * 0.5f;
+			float mx = (abx + bcx) * 0.5f, my = (aby + bcy) * 0.5f;
+			appendOutlineCurve(texels, x, y, (3.0f * (ax + abx) - x - mx) * 0.25f, (3.0f * (ay + aby) - y - my) * 0.25f, mx, my);
+			appendOutlineCurve(texels, mx, my, (3.0f * (bcx + cx) - mx - v.x) * 0.25f, (3.0f * (bcy + cy) - my - v.y) * 0.25f, v.x, v.y);
 			break;
-		case '=':
-			for (int x = 1; x < 7; x++) {
-				setPixel(fontData, textureWidth, startX, startY, x, 2);
-				setPixel(fontData, textureWidth, startX, startY, x, 5);
-			}
+		}
+		default:
 			break;
-		case '/':
-			for (int i = 0; i < 6; i++) {
-				setPixel(fontData, textureWidth, startX, startY, 5 - i, 1 + i);
+		}
+		x = v.x;
+		y = v.y;
+	}
+	stbtt_FreeShape(&font, vertices);
+	
+	texels[record + 4] = (float)((texels.size() - record - 8) / 8);
+	return true;
+}
+
+// Rasterize a glyph missing from the table into the cache. Codepoints no face has, and
+// glyphs larger than a page, are stored without a bitmap so they are not retried.
+static const Glyph* cacheGlyph(TextRenderer& renderer, uint32_t codepoint) {
+	GlyphCache& cache = renderer.glyphCache;
+	
+	Glyph glyph;
+	memset(&glyph, 0, sizeof(glyph));
+	FaceGlyph resolved = resolveFaceGlyph(renderer.faces, codepoint);
+	if (resolved.face < 0) {
+		insertGlyph(renderer.glyphs, codepoint, glyph);
+		return findGlyph(renderer.glyphs, codepoint);
+	}
+	const FontFace& face = renderer.faces[resolved.face];
+	int glyphIndex = resolved.glyphIndex;
+	glyph.flags = (uint16_t)(resolved.face << kGlyphFaceShift);
+	
+	int advance, lsb;
+	stbtt_GetGlyphHMetrics(&face.info, glyphIndex, &advance, &lsb);
+	glyph.advance = (uint16_t)lroundf((float)advance * face.scale * 64.0f);
+	
+	int width, height, xoff, yoff;
+	if (renderer.atlasMode == AtlasMode::Vector) {
+		// The glyph's record index goes where the atlas position would: low 16 bits in x, high in y
+		GlyphOutlines& outlines = renderer.outlines;
+		size_t record = outlines.texels.size() / 4;
+		if (appendGlyphOutline(face.info, face.scale, glyphIndex, outlines.texels, width, height, xoff, yoff)) {
+			if (outlines.texels.size() / 4 <= outlines.maxTexels) {
+				glyph.x = (uint16_t)(record & 0xFFFF);
+				glyph.y = (uint16_t)(record >> 16);
+				glyph.width = (uint16_t)width;
+				glyph.height = (uint16_t)height;
+				glyph.xoff = (int16_t)xoff;
+				glyph.yoff = (int16_t)yoff;
+			} else {
+				outlines.texels.resize(record * 4);  // Buffer texture full, draw as blank
 			}
-			break;
-		case '(':
-			for (int y = 2; y < 6; y++) setPixel(fontData, textureWidth, startX, startY, 2, y);
-			setPixel(fontData, textureWidth, startX, startY, 3, 1);
-			setPixel(fontData, textureWidth, startX, startY, 3, 6);
-			break;
-		case ')':
-			for (int y = 2; y < 6; y++) setPixel(fontData, textureWidth, startX, startY, 5, y);
-			setPixel(fontData, textureWidth, startX, startY, 4, 1);
-			setPixel(fontData, textureWidth, startX, startY, 4, 6);
-			break;
-		default:
-			for (int y = 1; y < 7; y++) {
-				setPixel(fontData, textureWidth, startX, startY, 1, y);
-				setPixel(fontData, textureWidth, startX, startY, 6, y);
+		}
+		insertGlyph(renderer.glyphs, codepoint, glyph);
+		return findGlyph(renderer.glyphs, codepoint);
+	}
+	
+	std::vector<unsigned char> strip;
+	bool hasBitmap = rasterizeGlyph(face.info, face.scale, glyphIndex, renderer.atlasMode, renderer.subpixelPhases,
+									strip, width, height, xoff, yoff);
+	int stripWidth = glyphStripWidth(width, renderer.subpixelPhases);
+	int pageHeight = cache.height / kGlyphCachePages;
+	int cellWidth = glyphCellStride(stripWidth);
+	int cellHeight = glyphCellStride(height);
+	if (hasBitmap && cellWidth <= cache.width && cellHeight <= pageHeight) {
+		int page, x, y;
+		if (!allocateGlyphCacheRect(renderer, cellWidth, cellHeight, page, x, y)) {
+			// Every page is in use this frame; try again next frame
+			cache.deferred = true;
+			return NULL;
+		}
+		
+		int cacheY = page * pageHeight + y;
+		blitAtlasRect(cache.pixels.data(), cache.width, cache.height, x, cacheY, strip.data(), stripWidth, stripWidth, height);
+		markGlyphCacheDirty(cache, x, cacheY, x + cellWidth, cacheY + cellHeight);
+		
+		glyph.x = (uint16_t)x;
+		glyph.y = (uint16_t)(cache.originY + cacheY);
+		glyph.width = (uint16_t)width;
+		glyph.height = (uint16_t)height;
+		glyph.xoff = (int16_t)xoff;
+		glyph.yoff = (int16_t)yoff;
+		glyph.flags |= (uint16_t)(kGlyphCached | (page << 8));
+		cache.pages[page].codepoints.push_back(codepoint);
+		cache.pages[page].lastUsed = renderer.frame;
+		cache.touchedPages |= 1u << page;
+	}
+	
+	insertGlyph(renderer.glyphs, codepoint, glyph);
+	return findGlyph(renderer.glyphs, codepoint);
+}
+
+// Look up a glyph for layout, rasterizing it into the cache on first use. The returned
+// pointer is only valid until the next acquireGlyph call.
+const Glyph* acquireGlyph(TextRenderer& renderer, uint32_t codepoint) {
+	const Glyph* glyph = findGlyph(renderer.glyphs, codepoint);
+	if (glyph) {
+		if (glyph->flags & kGlyphCached) {
+			renderer.glyphCache.pages[glyph->flags >> 8].lastUsed = renderer.frame;
+			renderer.glyphCache.touchedPages |= 1u << (glyph->flags >> 8);
+		}
+		return glyph;
+	}
+	if (renderer.faces.empty()) return NULL;
+	return cacheGlyph(renderer, codepoint);
+}
+
+// Upload outline records appended since the last upload, growing the buffer by doubling
+static void uploadGlyphOutlines(GlyphOutlines& outlines) {
+	size_t count = outlines.texels.size() / 4;
+	if (outlines.uploaded >= count) return;
+	
+	const size_t texelSize = 4 * sizeof(float);
+	glBindBuffer(GL_TEXTURE_BUFFER, outlines.buffer);
+	if (count > outlines.capacity) {
+		size_t capacity = outlines.capacity ? outlines.capacity : 4096;
+		while (capacity < count) capacity *= 2;
+		capacity = std::min(capacity, outlines.maxTexels);
+		glBufferData(GL_TEXTURE_BUFFER, capacity * texelSize, NULL, GL_DYNAMIC_DRAW);
+		outlines.capacity = capacity;
+		outlines.uploaded = 0;
+	}
+	glBufferSubData(GL_TEXTURE_BUFFER, outlines.uploaded * texelSize, (count - outlines.uploaded) * texelSize,
+					&outlines.texels[outlines.uploaded * 4]);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	outlines.uploaded = count;
+}
+
+// Upload the rectangle of the cache touched since the last upload, with the mip levels under it
+void uploadGlyphCache(TextRenderer& renderer) {
+	if (renderer.atlasMode == AtlasMode::Vector) {
+		uploadGlyphOutlines(renderer.outlines);
+		return;
+	}
+	
+	GlyphCache& cache = renderer.glyphCache;
+	if (cache.dirtyX0 >= cache.dirtyX1) return;
+	
+	// Cells sit on the gutter grid, as do originY and the cache size, so each level's rect is exact
+	int x0 = cache.dirtyX0 & ~(kAtlasGutter - 1);
+	int y0 = cache.dirtyY0 & ~(kAtlasGutter - 1);
+	int w = alignToGutter(cache.dirtyX1) - x0;
+	int h = alignToGutter(cache.dirtyY1) - y0;
+	const unsigned char* src = &cache.pixels[(size_t)y0 * cache.width + x0];
+	
+	glBindTexture(GL_TEXTURE_2D, renderer.fontTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, cache.width);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x0, cache.originY + y0, w, h, GL_RED, GL_UNSIGNED_BYTE, src);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	
+	int srcStride = cache.width;
+	std::vector<unsigned char> level, above;
+	for (int l = 1; l < kAtlasMipLevels; l++) {
+		w /= 2;
+		h /= 2;
+		level.resize((size_t)w * h);
+		downsampleAtlasRect(level.data(), w, src, srcStride, w, h);
+		glTexSubImage2D(GL_TEXTURE_2D, l, x0 >> l, (cache.originY + y0) >> l, w, h, GL_RED, GL_UNSIGNED_BYTE, level.data());
+		above.swap(level);
+		src = above.data();
+		srcStride = w;
+	}
+	cache.dirtyX0 = cache.dirtyX1 = 0;
+	cache.dirtyY0 = cache.dirtyY1 = 0;
+}
+
+// Start a new frame for glyph cache LRU tracking
+void beginTextFrame(TextRenderer& renderer) {
+	renderer.frame++;
+}
+
+// CPU side of a baked font atlas. Building it touches no GL state, so it can run on any thread.
+struct BakedAtlas {
+	int width, height;
+	std::vector<unsigned char> pixels;   // Mip chain, see atlasMipChainSize
+	GlyphTable glyphs;
+	KerningTable kerning;
+	float fontSize;
+	float scale;
+	AtlasMode mode;
+	int subpixelPhases;
+	
+	BakedAtlas() : width(0), height(0), fontSize(0.0f), scale(0.0f), mode(AtlasMode::Coverage), subpixelPhases(1) {}
+};
+
+// Run fn(worker, workerCount) on workerCount threads (worker 0 is the calling thread) and wait
+template <typename Fn>
+void runParallel(int workerCount, Fn fn) {
+	struct Task {
+		Fn* fn;
+		int worker, workerCount;
+		static int SDLCALL entry(void* data) {
+			Task* task = (Task*)data;
+			(*task->fn)(task->worker, task->workerCount);
+			return 0;
+		}
+	};
+	
+	std::vector<Task> tasks(workerCount);
+	std::vector<SDL_Thread*> threads(workerCount, (SDL_Thread*)NULL);
+	for (int w = 0; w < workerCount; w++) {
+		tasks[w].fn = &fn;
+		tasks[w].worker = w;
+		tasks[w].workerCount = workerCount;
+	}
+	for (int w = 1; w < workerCount; w++) {
+		threads[w] = SDL_CreateThread(Task::entry, "TextWorker", &tasks[w]);
+	}
+	fn(0, workerCount);
+	for (int w = 1; w < workerCount; w++) {
+		if (threads[w]) {
+			SDL_WaitThread(threads[w], NULL);
+		} else {
+			fn(w, workerCount);  // Thread creation failed, do its share here
+		}
+	}
+}
+
+// Worker count for atlas work: one per CPU, but no more than there are items to share
+int atlasWorkerCount(size_t items) {
+	int workers = SDL_GetCPUCount();
+	if (workers < 1) workers = 1;
+	if ((size_t)workers > items / 16 + 1) workers = (int)(items / 16 + 1);
+	return workers;
+}
+
+static inline uint16_t readBE16(const unsigned char* p) {
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t readBE32(const unsigned char* p) {
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void setCmapGlyph(CmapTable& cmap, uint32_t codepoint, uint32_t glyphIndex) {
+	if (codepoint >= 0x110000 || glyphIndex == 0 || glyphIndex > 0xFFFF) return;
+	uint16_t& page = cmap.pages[codepoint >> 8];
+	if (page == 0) {
+		page = (uint16_t)(cmap.glyphs.size() >> 8);
+		cmap.glyphs.resize(cmap.glyphs.size() + 256, 0);
+	}
+	cmap.glyphs[((size_t)page << 8) | (codepoint & 0xFF)] = (uint16_t)glyphIndex;
+}
+
+// Decode the cmap subtable stbtt_InitFont selected, mapping exactly as stbtt_FindGlyphIndex
+// does for formats 0, 4, 6, 12 and 13. Other formats leave the table empty.
+void buildCmapTable(CmapTable& cmap, const stbtt_fontinfo& info) {
+	cmap.pages.assign(kCmapPageCount, 0);
+	cmap.glyphs.assign(256, 0);
+	if (!info.index_map) return;
+	
+	const unsigned char* map = info.data + info.index_map;
+	uint16_t format = readBE16(map);
+	if (format == 0) {
+		uint32_t count = readBE16(map + 2) - 6;
+		for (uint32_t c = 0; c < count && c < 256; c++) setCmapGlyph(cmap, c, map[6 + c]);
+	} else if (format == 6) {
+		uint32_t first = readBE16(map + 6);
+		uint32_t count = readBE16(map + 8);
+		for (uint32_t i = 0; i < count; i++) setCmapGlyph(cmap, first + i, readBE16(map + 10 + i * 2));
+	} else if (format == 4) {
+		uint32_t segCount = readBE16(map + 6) >> 1;
+		const unsigned char* endCodes = map + 14;
+		const unsigned char* startCodes = endCodes + segCount * 2 + 2;
+		const unsigned char* idDeltas = startCodes + segCount * 2;
+		const unsigned char* idRangeOffsets = idDeltas + segCount * 2;
+		for (uint32_t seg = 0; seg < segCount; seg++) {
+			uint32_t start = readBE16(startCodes + seg * 2);
+			uint32_t end = readBE16(endCodes + seg * 2);
+			uint16_t delta = readBE16(idDeltas + seg * 2);
+			uint16_t rangeOffset = readBE16(idRangeOffsets + seg * 2);
+			for (uint32_t c = start; c <= end; c++) {
+				// Like stbtt, idDelta only applies to segments without a glyph id array
+				uint32_t glyph = rangeOffset
+					? readBE16(idRangeOffsets + seg * 2 + rangeOffset + (c - start) * 2)
+					: (uint16_t)(c + delta);
+				setCmapGlyph(cmap, c, glyph);
 			}
-			for (int x = 1; x < 7; x++) {
-				setPixel(fontData, textureWidth, startX, startY, x, 1);
-				setPixel(fontData, textureWidth, startX, startY, x, 6);
+		}
+	} else if (format == 12 || format == 13) {
+		uint32_t groups = readBE32(map + 12);
+		for (uint32_t g = 0; g < groups; g++) {
+			const unsigned char* group = map + 16 + g * 12;
+			uint32_t start = readBE32(group);
+			uint32_t end = std::min(readBE32(group + 4), 0x10FFFFu);
+			uint32_t startGlyph = readBE32(group + 8);
+			for (uint32_t c = start; c <= end; c++) {
+				setCmapGlyph(cmap, c, format == 12 ? startGlyph + (c - start) : startGlyph);
 			}
-			break;
+		}
 	}
 }
 
-bool loadTTFFont(const char* fontPath, TextRenderer& renderer, float fontSize) {
+bool loadFontFace(const char* fontPath, FontFace& face) {
 	std::ifstream file(fontPath, std::ios::binary | std::ios::ate);
 	if (!file.is_open()) {
 		return false;
 	}
 	
-	std::streamsize size = file.tellg();
-	file.seekg(0, std::ios::beg);
+	std::streamsize size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	
+	std::vector<unsigned char> fontBuffer(size);
+	if (!file.read((char*)fontBuffer.data(), size)) {
+		return false;
+	}
+	file.close();
+	
+	stbtt_fontinfo font;
+	if (!stbtt_InitFont(&font, fontBuffer.data(), stbtt_GetFontOffsetForIndex(fontBuffer.data(), 0))) {
+		return false;
+	}
+	
+	// swap keeps the buffer font.data points at
+	face.data.swap(fontBuffer);
+	face.info = font;
+	buildCmapTable(face.cmap, face.info);
+	face.loaded = true;
+	return true;
+}
+
+// Printable ASCII and Latin-1 Supplement; other codepoints go through the glyph cache
+std::vector<uint32_t> bakedGlyphSet() {
+	std::vector<uint32_t> glyphSet;
+	for (uint32_t c = 32; c < 127; c++) glyphSet.push_back(c);
+	for (uint32_t c = 160; c < 256; c++) glyphSet.push_back(c);
+	return glyphSet;
+}
+
+// One glyph moving through the atlas build phases
+struct GlyphRaster {
+	uint32_t codepoint;
+	int face;
+	int glyphIndex;
+	int advance;
+	int width, height, xoff, yoff;   // width spans every subpixel variant
+	int cellWidth;       // Width of one variant
+	int worker;          // Scratch buffer holding the bitmap
+	size_t offset;       // Bitmap offset inside that scratch buffer
+	int x, y;            // Atlas position assigned by packing
+};
+
+const int kMaxAtlasSize = 4096;
+
+// Pack rasters into the smallest power-of-two atlas that holds them, trying sizes in order
+// of area, the squarest shape first. Glyphs go in tallest first, each in a cell of glyphCellStride
+// texels per side; with every cell a multiple of kAtlasGutter, packed positions land on the grid.
+static bool packGlyphRasters(std::vector<GlyphRaster>& rasters, int& atlasWidth, int& atlasHeight) {
+	std::vector<size_t> order;
+	size_t area = 0;
+	for (size_t i = 0; i < rasters.size(); i++) {
+		if (rasters[i].width == 0) continue;
+		order.push_back(i);
+		area += (size_t)glyphCellStride(rasters[i].width) * glyphCellStride(rasters[i].height);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		if (rasters[a].height != rasters[b].height) return rasters[a].height > rasters[b].height;
+		return rasters[a].width > rasters[b].width;
+	});
+	
+	SkylinePacker packer;
+	for (int log2Area = 8; log2Area <= 24; log2Area++) {
+		for (int log2Width = (log2Area + 1) / 2; log2Width <= (log2Area + 1) / 2 + 1; log2Width++) {
+			int width = 1 << log2Width;
+			int height = 1 << (log2Area - log2Width);
+			if ((size_t)width * height < area || width > kMaxAtlasSize || height > kMaxAtlasSize) continue;
+			
+			resetSkyline(packer, width, height);
+			bool fits = true;
+			for (size_t i = 0; i < order.size() && fits; i++) {
+				GlyphRaster& raster = rasters[order[i]];
+				fits = skylineInsert(packer, glyphCellStride(raster.width), glyphCellStride(raster.height), raster.x, raster.y);
+			}
+			if (fits) {
+				atlasWidth = width;
+				atlasHeight = height;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Kerning between the glyphs in rasters. It only applies between glyphs of the same face.
+static void buildChainKerning(const std::vector<FontFace>& faces, const std::vector<float>& scales,
+							  const std::vector<GlyphRaster>& rasters, KerningTable& kerning) {
+	KerningPairs pairs;
+	for (size_t f = 0; f < faces.size(); f++) {
+		std::vector<uint32_t> codepoints;
+		std::vector<int> glyphIndices;
+		for (const GlyphRaster& raster : rasters) {
+			if (raster.face != (int)f || raster.glyphIndex == 0) continue;
+			codepoints.push_back(raster.codepoint);
+			glyphIndices.push_back(raster.glyphIndex);
+		}
+		collectKerningPairs(pairs, faces[f].info, scales[f], codepoints, glyphIndices);
+	}
+	buildKerningTable(kerning, pairs);
+}
+
+// Build the baked atlas in three phases: glyphs are rasterized in parallel into per-worker
+// scratch buffers, packed serially, then blitted in parallel. The mip levels follow. Packing only depends on glyph
+// order and sizes, so the result is byte-identical for any worker count.
+bool bakeFontAtlas(const std::vector<FontFace>& faces, float fontSize, AtlasMode mode, int subpixelPhases,
+				   int workerCount, BakedAtlas& atlas) {
+	if (faces.empty()) return false;
+	subpixelPhases = atlasSubpixelPhases(mode, subpixelPhases);
+	std::vector<float> scales(faces.size());
+	for (size_t i = 0; i < faces.size(); i++) {
+		scales[i] = stbtt_ScaleForPixelHeight(&faces[i].info, fontSize);
+	}
+	
+	// Resolve the glyph set through the fallback chain; ASCII the chain lacks stays as
+	// the primary face's missing glyph
+	std::vector<GlyphRaster> rasters;
+	for (uint32_t c : bakedGlyphSet()) {
+		FaceGlyph resolved = resolveFaceGlyph(faces, c);
+		if (resolved.face < 0) {
+			if (c >= 127) continue;
+			resolved.face = 0;
+		}
+		GlyphRaster raster;
+		memset(&raster, 0, sizeof(raster));
+		raster.codepoint = c;
+		raster.face = resolved.face;
+		raster.glyphIndex = resolved.glyphIndex;
+		rasters.push_back(raster);
+	}
+	if (workerCount < 1) workerCount = 1;
+	
+	// Phase 1: rasterize. Worker w takes every workerCount-th glyph into its own scratch.
+	std::vector<std::vector<unsigned char>> scratch(workerCount);
+	runParallel(workerCount, [&](int worker, int workers) {
+		std::vector<unsigned char>& buffer = scratch[worker];
+		for (size_t i = worker; i < rasters.size(); i += workers) {
+			GlyphRaster& raster = rasters[i];
+			const stbtt_fontinfo& font = faces[raster.face].info;
+			float scale = scales[raster.face];
+			int lsb;
+			stbtt_GetGlyphHMetrics(&font, raster.glyphIndex, &raster.advance, &lsb);
+			raster.worker = worker;
+			raster.offset = buffer.size();
+			
+			// Blank glyphs such as the space have no bitmap but still need their advance
+			if (rasterizeGlyph(font, scale, raster.glyphIndex, mode, subpixelPhases, buffer,
+							   raster.cellWidth, raster.height, raster.xoff, raster.yoff)) {
+				raster.width = glyphStripWidth(raster.cellWidth, subpixelPhases);
+			}
+		}
+	});
+	
+	// Phase 2: pack serially
+	int atlasWidth, atlasHeight;
+	if (!packGlyphRasters(rasters, atlasWidth, atlasHeight)) {
+		return false;
+	}
+	
+	// Phase 3: blit in parallel; glyph rects are disjoint so workers never share a byte
+	atlas.width = atlasWidth;
+	atlas.height = atlasHeight;
+	atlas.pixels.assign((size_t)atlasWidth * atlasHeight, 0);
+	runParallel(workerCount, [&](int worker, int workers) {
+		for (size_t i = worker; i < rasters.size(); i += workers) {
+			const GlyphRaster& raster = rasters[i];
+			const unsigned char* bitmap = scratch[raster.worker].data() + raster.offset;
+			blitAtlasRect(atlas.pixels.data(), atlasWidth, atlasHeight, raster.x, raster.y,
+						  bitmap, raster.width, raster.width, raster.height);
+		}
+	});
+	buildAtlasMips(atlas.pixels, atlasWidth, atlasHeight);
+	
+	clearGlyphTable(atlas.glyphs);
+	for (const GlyphRaster& raster : rasters) {
+		Glyph glyph;
+		glyph.x = (uint16_t)raster.x;
+		glyph.y = (uint16_t)raster.y;
+		glyph.width = (uint16_t)raster.cellWidth;
+		glyph.height = (uint16_t)raster.height;
+		glyph.xoff = (int16_t)raster.xoff;
+		glyph.yoff = (int16_t)raster.yoff;
+		glyph.advance = (uint16_t)lroundf((float)raster.advance * scales[raster.face] * 64.0f);
+		glyph.flags = (uint16_t)(raster.face << kGlyphFaceShift);
+		insertGlyph(atlas.glyphs, raster.codepoint, glyph);
+	}
+	
+	buildChainKerning(faces, scales, rasters, atlas.kerning);
+	
+	atlas.fontSize = fontSize;
+	atlas.scale = scales[0];
+	atlas.mode = mode;
+	atlas.subpixelPhases = subpixelPhases;
+	return true;
+}
+
+// Vector text has nothing to bake: outlines are read when a glyph is first drawn, so only
+// the kerning of the baked glyph set is prepared. The atlas is left empty.
+bool prepareVectorFont(const std::vector<FontFace>& faces, float fontSize, BakedAtlas& atlas) {
+	if (faces.empty()) return false;
+	std::vector<float> scales(faces.size());
+	for (size_t i = 0; i < faces.size(); i++) {
+		scales[i] = stbtt_ScaleForPixelHeight(&faces[i].info, fontSize);
+	}
+	
+	std::vector<GlyphRaster> rasters;
+	for (uint32_t c : bakedGlyphSet()) {
+		FaceGlyph resolved = resolveFaceGlyph(faces, c);
+		if (resolved.face < 0) continue;
+		GlyphRaster raster;
+		memset(&raster, 0, sizeof(raster));
+		raster.codepoint = c;
+		raster.face = resolved.face;
+		raster.glyphIndex = resolved.glyphIndex;
+		rasters.push_back(raster);
+	}
+	buildChainKerning(faces, scales, rasters, atlas.kerning);
+	
+	atlas.width = atlas.height = 0;
+	atlas.pixels.clear();
+	clearGlyphTable(atlas.glyphs);
+	atlas.fontSize = fontSize;
+	atlas.scale = scales[0];
+	atlas.mode = AtlasMode::Vector;
+	atlas.subpixelPhases = 1;
+	return true;
+}
+
+// Read-only view of a whole file
+struct MappedFile {
+	HANDLE file, mapping;
+	const unsigned char* data;
+	size_t size;
+	
+	MappedFile() : file(INVALID_HANDLE_VALUE), mapping(NULL), data(NULL), size(0) {}
+};
+
+static std::wstring widenPath(const std::string& path) {
+	std::wstring widePath(path.size(), L'\0');
+	int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), (int)path.size(), &widePath[0], (int)widePath.size());
+	widePath.resize(length > 0 ? length : 0);
+	return widePath;
+}
+
+bool mapFile(const std::string& path, MappedFile& mapped) {
+	std::wstring widePath = widenPath(path);
+	mapped.file = CreateFile2(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, NULL);
+	if (mapped.file == INVALID_HANDLE_VALUE) return false;
+	
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(mapped.file, &fileSize) && fileSize.QuadPart > 0) {
+		mapped.mapping = CreateFileMappingFromApp(mapped.file, NULL, PAGE_READONLY, 0, NULL);
+	}
+	if (mapped.mapping) {
+		mapped.data = (const unsigned char*)MapViewOfFileFromApp(mapped.mapping, FILE_MAP_READ, 0, 0);
+		mapped.size = (size_t)fileSize.QuadPart;
+	}
+	if (!mapped.data) {
+		if (mapped.mapping) CloseHandle(mapped.mapping);
+		CloseHandle(mapped.file);
+		mapped = MappedFile();
+		return false;
+	}
+	return true;
+}
+
+void unmapFile(MappedFile& mapped) {
+	if (mapped.data) UnmapViewOfFile(mapped.data);
+	if (mapped.mapping) CloseHandle(mapped.mapping);
+	if (mapped.file != INVALID_HANDLE_VALUE) CloseHandle(mapped.file);
+	mapped = MappedFile();
+}
+
+// Baked atlas cache file: header, kerning keys, glyph records, kerning values, then the
+// atlas pixels, each section at its natural alignment so the pixels upload straight
+// from the mapping. Bump kAtlasCacheVersion whenever bakeFontAtlas output changes.
+const uint32_t kAtlasCacheMagic = 0x43415854;  // "TXAC"
+const uint32_t kAtlasCacheVersion = 4;
+
+struct AtlasCacheHeader {
+	uint32_t magic, version;
+	uint64_t key;
+	int32_t width, height;
+	float fontSize, scale;
+	uint32_t mode;
+	uint32_t glyphCount;
+	uint32_t kerningSlots;
+	uint32_t subpixelPhases;
+};
+
+struct AtlasCacheGlyph {
+	uint32_t codepoint;
+	Glyph glyph;
+};
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+	}
+	return hash;
+}
+
+// Identifies one bake: contents of every face in order, pixel size, atlas mode, subpixel
+// phases and glyph set
+uint64_t atlasCacheKey(const std::vector<FontFace>& faces, float fontSize, AtlasMode mode, int subpixelPhases,
+					   const std::vector<uint32_t>& glyphSet) {
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (const FontFace& face : faces) {
+		uint64_t size = face.data.size();
+		hash = fnv1a(hash, &size, sizeof(size));
+		hash = fnv1a(hash, face.data.data(), face.data.size());
+	}
+	hash = fnv1a(hash, &fontSize, sizeof(fontSize));
+	uint32_t modeValue = (uint32_t)mode;
+	hash = fnv1a(hash, &modeValue, sizeof(modeValue));
+	uint32_t phases = (uint32_t)subpixelPhases;
+	hash = fnv1a(hash, &phases, sizeof(phases));
+	hash = fnv1a(hash, glyphSet.data(), glyphSet.size() * sizeof(uint32_t));
+	return hash;
+}
+
+// Cache files live in the app's local folder, one per key
+std::string atlasCachePath(uint64_t key) {
+	char* prefPath = SDL_GetPrefPath("uwp_gl_sample", "atlas");
+	if (!prefPath) return std::string();
+	char name[40];
+	snprintf(name, sizeof(name), "atlas-%016llx.bin", (unsigned long long)key);
+	std::string path = std::string(prefPath) + name;
+	SDL_free(prefPath);
+	return path;
+}
+
+static size_t atlasCacheSectionSize(const AtlasCacheHeader& header) {
+	return sizeof(AtlasCacheHeader) + (size_t)header.kerningSlots * sizeof(uint64_t) +
+		(size_t)header.glyphCount * sizeof(AtlasCacheGlyph) + (size_t)header.kerningSlots * sizeof(int16_t) +
+		atlasMipChainSize(header.width, header.height);
+}
+
+// Written to a temporary file of this thread's own and renamed over path once complete, so a
+// reader never maps a partial file and concurrent writers never interleave
+bool writeAtlasCache(const std::string& path, uint64_t key, const BakedAtlas& atlas) {
+	std::vector<AtlasCacheGlyph> glyphs;
+	for (uint32_t c = 0; c < kGlyphDenseCount; c++) {
+		if (atlas.glyphs.dense[c].flags & kGlyphPresent) glyphs.push_back({ c, atlas.glyphs.dense[c] });
+	}
+	for (const auto& entry : atlas.glyphs.sparse) {
+		glyphs.push_back({ entry.first, entry.second });
+	}
+	
+	AtlasCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kAtlasCacheMagic;
+	header.version = kAtlasCacheVersion;
+	header.key = key;
+	header.width = atlas.width;
+	header.height = atlas.height;
+	header.fontSize = atlas.fontSize;
+	header.scale = atlas.scale;
+	header.mode = (uint32_t)atlas.mode;
+	header.subpixelPhases = (uint32_t)atlas.subpixelPhases;
+	header.glyphCount = (uint32_t)glyphs.size();
+	header.kerningSlots = (uint32_t)atlas.kerning.keys.size();
+	
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%lx.tmp", (unsigned long)SDL_ThreadID());
+	std::string tempPath = path + suffix;
+	
+	std::ofstream file(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) return false;
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)atlas.kerning.keys.data(), atlas.kerning.keys.size() * sizeof(uint64_t));
+	file.write((const char*)glyphs.data(), glyphs.size() * sizeof(AtlasCacheGlyph));
+	file.write((const char*)atlas.kerning.values.data(), atlas.kerning.values.size() * sizeof(int16_t));
+	file.write((const char*)atlas.pixels.data(), atlas.pixels.size());
+	file.close();
+	
+	// Replacing fails while another reader has path mapped; its copy is as good as ours
+	if (!file.good() || !MoveFileExW(widenPath(tempPath).c_str(), widenPath(path).c_str(), MOVEFILE_REPLACE_EXISTING)) {
+		std::remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Map a cache file and fill the atlas metadata from it. The pixels (the whole mip chain) are
+// left in the mapping and returned through pixels, valid until unmapFile. The header must
+// match the requested mode and phases as well as the key.
+bool readAtlasCache(const std::string& path, uint64_t key, AtlasMode mode, int subpixelPhases, MappedFile& mapped,
+					BakedAtlas& atlas, const unsigned char*& pixels) {
+	if (!mapFile(path, mapped)) return false;
+	
+	AtlasCacheHeader header;
+	if (mapped.size < sizeof(header)) {
+		unmapFile(mapped);
+		return false;
+	}
+	memcpy(&header, mapped.data, sizeof(header));
+	if (header.magic != kAtlasCacheMagic || header.version != kAtlasCacheVersion || header.key != key ||
+		header.mode != (uint32_t)mode || header.subpixelPhases != (uint32_t)subpixelPhases ||
+		header.width <= 0 || header.height <= 0 || mapped.size != atlasCacheSectionSize(header)) {
+		unmapFile(mapped);
+		return false;
+	}
+	
+	const unsigned char* cursor = mapped.data + sizeof(header);
+	const uint64_t* keys = (const uint64_t*)cursor;
+	cursor += (size_t)header.kerningSlots * sizeof(uint64_t);
+	const AtlasCacheGlyph* glyphs = (const AtlasCacheGlyph*)cursor;
+	cursor += (size_t)header.glyphCount * sizeof(AtlasCacheGlyph);
+	const int16_t* values = (const int16_t*)cursor;
+	cursor += (size_t)header.kerningSlots * sizeof(int16_t);
+	
+	clearGlyphTable(atlas.glyphs);
+	for (uint32_t i = 0; i < header.glyphCount; i++) {
+		insertGlyph(atlas.glyphs, glyphs[i].codepoint, glyphs[i].glyph);
+	}
+	atlas.kerning.keys.assign(keys, keys + header.kerningSlots);
+	atlas.kerning.values.assign(values, values + header.kerningSlots);
+	atlas.kerning.mask = header.kerningSlots ? header.kerningSlots - 1 : 0;
+	atlas.kerning.count = header.kerningSlots - std::count(keys, keys + header.kerningSlots, 0ull);
+	
+	atlas.width = header.width;
+	atlas.height = header.height;
+	atlas.fontSize = header.fontSize;
+	atlas.scale = header.scale;
+	atlas.mode = (AtlasMode)header.mode;
+	atlas.subpixelPhases = (int)header.subpixelPhases;
+	pixels = cursor;
+	return true;
+}
+
+// Switch the renderer to vector text: release the atlas texture and start an empty outline
+// buffer. Glyphs fill it as they are first drawn.
+static void uploadVectorFont(TextRenderer& renderer) {
+	GlyphOutlines& outlines = renderer.outlines;
+	if (!outlines.buffer) {
+		GLint maxTexels = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+		outlines.maxTexels = (size_t)maxTexels;
+		glGenBuffers(1, &outlines.buffer);
+		glGenTextures(1, &outlines.texture);
+		glBindBuffer(GL_TEXTURE_BUFFER, outlines.buffer);
+		outlines.capacity = 4096;
+		glBufferData(GL_TEXTURE_BUFFER, outlines.capacity * 4 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		glBindTexture(GL_TEXTURE_BUFFER, outlines.texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, outlines.buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+	}
+	outlines.texels.clear();
+	outlines.uploaded = 0;
+	
+	glDeleteTextures(1, &renderer.fontTexture);
+	renderer.fontTexture = 0;
+	renderer.fontTextureWidth = 0;
+	renderer.fontTextureHeight = 0;
+	renderer.glyphCache.generation++;  // Invalidate layouts built against the old atlas
+}
+
+// Rows per cache page: two rows of the tallest baked glyph (at least one em), so the band
+// follows the font size instead of being a fixed block below a possibly small atlas
+static int glyphCachePageHeight(const BakedAtlas& atlas) {
+	int tallest = (int)ceilf(atlas.fontSize);
+	for (uint32_t c = 0; c < kGlyphDenseCount; c++) {
+		tallest = std::max(tallest, (int)atlas.glyphs.dense[c].height);
+	}
+	for (const auto& entry : atlas.glyphs.sparse) {
+		tallest = std::max(tallest, (int)entry.second.height);
+	}
+	return 2 * glyphCellStride(tallest);
+}
+
+// Make a baked atlas current: take over its tables and upload pixels (the atlas mip chain)
+// together with the (empty) glyph cache rows below it, for trilinear sampling
+void uploadBakedAtlas(TextRenderer& renderer, const BakedAtlas& atlas, const unsigned char* pixels) {
+	const int pageHeight = glyphCachePageHeight(atlas);
+	const int textureWidth = atlas.width;
+	const int textureHeight = atlas.height + kGlyphCachePages * pageHeight;
+	
+	renderer.glyphs = atlas.glyphs;
+	renderer.kerning = atlas.kerning;
+	renderer.fontSize = atlas.fontSize;
+	renderer.fontScale = atlas.scale;
+	for (FontFace& face : renderer.faces) {
+		face.scale = stbtt_ScaleForPixelHeight(&face.info, atlas.fontSize);
+	}
+	renderer.atlasMode = atlas.mode;
+	renderer.subpixelPhases = atlas.subpixelPhases;
+	renderer.metricsGeneration++;
+	if (atlas.mode == AtlasMode::Vector) {
+		uploadVectorFont(renderer);
+		return;
+	}
+	initGlyphCache(renderer.glyphCache, textureWidth, atlas.height, pageHeight);
+	renderer.glyphCache.generation++;  // Invalidate layouts built against the old atlas
+	
+	// Create OpenGL texture
+	if (!renderer.fontTexture) glGenTextures(1, &renderer.fontTexture);
+	glBindTexture(GL_TEXTURE_2D, renderer.fontTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (int level = 0; level < kAtlasMipLevels; level++) {
+		// The cache rows are still empty, so its zeroed mirror serves every level
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RED, textureWidth >> level, textureHeight >> level, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, atlas.width >> level, atlas.height >> level, GL_RED, GL_UNSIGNED_BYTE, pixels);
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, atlas.height >> level, textureWidth >> level, renderer.glyphCache.height >> level,
+						GL_RED, GL_UNSIGNED_BYTE, renderer.glyphCache.pixels.data());
+		pixels += (size_t)(atlas.width >> level) * (atlas.height >> level);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, kAtlasMipLevels - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	
+	renderer.fontTextureWidth = textureWidth;
+	renderer.fontTextureHeight = textureHeight;
+	printf("Font texture: %dx%d (%d atlas rows, %d cache rows), %.1f KB with mips\n", textureWidth, textureHeight,
+		   atlas.height, renderer.glyphCache.height, atlasMipChainSize(textureWidth, textureHeight) / 1024.0f);
+}
+
+// Fraction of the atlas covered by glyph bitmaps
+float atlasPackingEfficiency(const BakedAtlas& atlas) {
+	size_t used = 0;
+	for (uint32_t c = 0; c < kGlyphDenseCount; c++) {
+		used += (size_t)atlas.glyphs.dense[c].width * atlas.glyphs.dense[c].height * atlas.subpixelPhases;
+	}
+	for (const auto& entry : atlas.glyphs.sparse) {
+		used += (size_t)entry.second.width * entry.second.height * atlas.subpixelPhases;
+	}
+	return (float)used / (float)((size_t)atlas.width * atlas.height);
+}
+
+static bool bakeAndCacheFontAtlas(const std::vector<FontFace>& faces, float fontSize, AtlasMode mode, int subpixelPhases,
+								  size_t glyphCount, uint64_t key, const std::string& cachePath, BakedAtlas& atlas) {
+	if (!bakeFontAtlas(faces, fontSize, mode, subpixelPhases, atlasWorkerCount(glyphCount), atlas)) {
+		return false;
+	}
+	printf("Font atlas: %dx%d at %.0f px, %zu glyphs, %.1f%% packed\n", atlas.width, atlas.height, fontSize,
+		   atlas.glyphs.count, atlasPackingEfficiency(atlas) * 100.0f);
+	if (!cachePath.empty() && !writeAtlasCache(cachePath, key, atlas)) {
+		printf("Could not write atlas cache %s\n", cachePath.c_str());
+	}
+	return true;
+}
+
+// Upload the atlas for faces at fontSize, from the cache file when one matches; otherwise
+// bake it and write the cache for the next start. Vector text skips both.
+bool prepareFontAtlas(const std::vector<FontFace>& faces, float fontSize, AtlasMode mode, int subpixelPhases,
+					  TextRenderer& renderer) {
+	BakedAtlas atlas;
+	if (mode == AtlasMode::Vector) {
+		if (!prepareVectorFont(faces, fontSize, atlas)) return false;
+		uploadBakedAtlas(renderer, atlas, NULL);
+		return true;
+	}
+	
+	// Clamped before the key, so requests that bake the same atlas share its cache file
+	subpixelPhases = atlasSubpixelPhases(mode, subpixelPhases);
+	std::vector<uint32_t> glyphSet = bakedGlyphSet();
+	uint64_t key = atlasCacheKey(faces, fontSize, mode, subpixelPhases, glyphSet);
+	std::string cachePath = atlasCachePath(key);
+	
+	MappedFile mapped;
+	const unsigned char* pixels = NULL;
+	if (!cachePath.empty() && readAtlasCache(cachePath, key, mode, subpixelPhases, mapped, atlas, pixels)) {
+		uploadBakedAtlas(renderer, atlas, pixels);
+		unmapFile(mapped);
+		return true;
+	}
+	
+	if (!bakeAndCacheFontAtlas(faces, fontSize, mode, subpixelPhases, glyphSet.size(), key, cachePath, atlas)) {
+		return false;
+	}
+	uploadBakedAtlas(renderer, atlas, atlas.pixels.data());
+	return true;
+}
+
+// CPU half of prepareFontAtlas, filling atlas from the cache file or by baking. Touches no
+// GL or renderer state, so it can run on a worker thread.
+bool loadBakedAtlas(const std::vector<FontFace>& faces, float fontSize, AtlasMode mode, int subpixelPhases,
+					BakedAtlas& atlas) {
+	if (mode == AtlasMode::Vector) return prepareVectorFont(faces, fontSize, atlas);
+	
+	subpixelPhases = atlasSubpixelPhases(mode, subpixelPhases);
+	std::vector<uint32_t> glyphSet = bakedGlyphSet();
+	uint64_t key = atlasCacheKey(faces, fontSize, mode, subpixelPhases, glyphSet);
+	std::string cachePath = atlasCachePath(key);
+	
+	MappedFile mapped;
+	const unsigned char* pixels = NULL;
+	if (!cachePath.empty() && readAtlasCache(cachePath, key, mode, subpixelPhases, mapped, atlas, pixels)) {
+		atlas.pixels.assign(pixels, pixels + atlasMipChainSize(atlas.width, atlas.height));
+		unmapFile(mapped);
+		return true;
+	}
+	return bakeAndCacheFontAtlas(faces, fontSize, mode, subpixelPhases, glyphSet.size(), key, cachePath, atlas);
+}
+
+// Load the fallback chain in order and bake its atlas. Faces that fail to load are
+// skipped; at least one has to load.
+bool loadFontCollection(const std::vector<std::string>& fontPaths, TextRenderer& renderer, float fontSize, AtlasMode mode,
+						int subpixelPhases) {
+	std::vector<FontFace> faces;
+	faces.reserve(fontPaths.size());  // Loaded in place: moving a face is fine, copying is not
+	for (const std::string& path : fontPaths) {
+		if ((int)faces.size() == kMaxFontFaces) break;
+		faces.push_back(FontFace());
+		if (!loadFontFace(path.c_str(), faces.back())) {
+			printf("Could not load font %s\n", path.c_str());
+			faces.pop_back();
+		}
+	}
+	if (faces.empty()) {
+		return false;
+	}
+	
+	// Keep the faces open for glyphs rasterized on demand
+	renderer.faces.swap(faces);
+	if (!prepareFontAtlas(renderer.faces, fontSize, mode, subpixelPhases, renderer)) {
+		renderer.faces.clear();
+		return false;
+	}
+	return true;
+}
+
+// Atlas rebuild running on a worker thread. It only touches CPU-side data, so the main
+// thread keeps drawing with the current atlas and uploads the new one once it is done.
+struct AtlasRebuild {
+	SDL_Thread* thread;
+	SDL_atomic_t done;
+	const std::vector<FontFace>* faces;  // Read-only while the rebuild runs
+	float fontSize;
+	AtlasMode mode;
+	int subpixelPhases;
+	BakedAtlas atlas;
+	bool ok;
+	bool active;
+	
+	AtlasRebuild() : thread(NULL), faces(NULL), fontSize(0.0f), mode(AtlasMode::Coverage), subpixelPhases(1),
+					 ok(false), active(false) {
+		SDL_AtomicSet(&done, 0);
+	}
+};
+
+static int SDLCALL atlasRebuildThread(void* data) {
+	AtlasRebuild* rebuild = (AtlasRebuild*)data;
+	rebuild->ok = loadBakedAtlas(*rebuild->faces, rebuild->fontSize, rebuild->mode, rebuild->subpixelPhases, rebuild->atlas);
+	SDL_AtomicSet(&rebuild->done, 1);
+	return 0;
+}
+
+// Start re-baking the renderer's faces at fontSize. Does nothing while a rebuild is running.
+void startAtlasRebuild(AtlasRebuild& rebuild, const TextRenderer& renderer, float fontSize, AtlasMode mode,
+					   int subpixelPhases) {
+	if (rebuild.active || renderer.faces.empty()) return;
+	
+	rebuild.faces = &renderer.faces;
+	rebuild.fontSize = fontSize;
+	rebuild.mode = mode;
+	rebuild.subpixelPhases = subpixelPhases;
+	rebuild.atlas = BakedAtlas();
+	rebuild.ok = false;
+	rebuild.active = true;
+	SDL_AtomicSet(&rebuild.done, 0);
+	rebuild.thread = SDL_CreateThread(atlasRebuildThread, "AtlasRebuild", &rebuild);
+	if (!rebuild.thread) {
+		atlasRebuildThread(&rebuild);  // No thread available, rebuild inline
+	}
+}
+
+// Upload a finished rebuild without blocking. Returns true when the renderer switched to
+// the new atlas; a result for an atlas format switched away from meanwhile is dropped.
+bool finishAtlasRebuild(AtlasRebuild& rebuild, TextRenderer& renderer) {
+	if (!rebuild.active || !SDL_AtomicGet(&rebuild.done)) return false;
+	if (rebuild.thread) SDL_WaitThread(rebuild.thread, NULL);
+	rebuild.thread = NULL;
+	rebuild.active = false;
+	
+	bool switched = rebuild.ok && rebuild.atlas.mode == renderer.atlasMode &&
+		rebuild.atlas.subpixelPhases == renderer.subpixelPhases;
+	if (switched) uploadBakedAtlas(renderer, rebuild.atlas, rebuild.atlas.pixels.data());
+	rebuild.atlas = BakedAtlas();
+	return switched;
+}
+
+// Wait for a running rebuild and discard its result
+void cancelAtlasRebuild(AtlasRebuild& rebuild) {
+	if (rebuild.thread) SDL_WaitThread(rebuild.thread, NULL);
+	rebuild.thread = NULL;
+	rebuild.active = false;
+	rebuild.atlas = BakedAtlas();
+}
+
+// Create a simple bitmap font texture (this is only a fallback): a single upload of the
+// image built at compile time
+void createBitmapFontTexture(GLuint* texture) {
+	glGenTextures(1, texture);
+	glBindTexture(GL_TEXTURE_2D, *texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, kBitmapFontTextureWidth, kBitmapFontTextureHeight, 0, GL_RED, GL_UNSIGNED_BYTE,
+				 kBitmapFontImage.pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+static void waitStreamFence(GLsync& fence) {
+	if (!fence) return;
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while (result == GL_TIMEOUT_EXPIRED) {
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+	}
+	glDeleteSync(fence);
+	fence = 0;
+}
+
+static void releaseStreamStorage(StreamBuffer& stream) {
+	for (int i = 0; i < kStreamFramesInFlight; i++) {
+		if (stream.fences[i]) {
+			glDeleteSync(stream.fences[i]);
+			stream.fences[i] = 0;
+		}
+	}
+	if (stream.buffer) {
+		// Draws already issued keep the old storage alive until the GPU is done with it
+		if (stream.mapped) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		}
+		glDeleteBuffers(1, &stream.buffer);
+	}
+	stream.buffer = 0;
+	stream.mapped = NULL;
+}
+
+static bool createStreamStorage(StreamBuffer& stream, size_t regionSize) {
+	GLsizeiptr totalSize = (GLsizeiptr)(regionSize * kStreamFramesInFlight);
+	glGenBuffers(1, &stream.buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+	
+	if (stream.persistent) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, NULL, flags);
+		stream.mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags);
+		if (!stream.mapped) {
+			printf("Persistent stream mapping failed, using unsynchronized maps\n");
+			glDeleteBuffers(1, &stream.buffer);
+			stream.persistent = false;
+			glGenBuffers(1, &stream.buffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+		}
+	}
+	if (!stream.persistent) {
+		glBufferData(GL_COPY_WRITE_BUFFER, totalSize, NULL, GL_STREAM_DRAW);
+	}
+	
+	stream.regionSize = regionSize;
+	stream.offset = 0;
+	return glGetError() == GL_NO_ERROR;
+}
+
+bool initStreamBuffer(StreamBuffer& stream, size_t regionSize) {
+	stream.persistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+	stream.region = 0;
+	return createStreamStorage(stream, regionSize);
+}
+
+void destroyStreamBuffer(StreamBuffer& stream) {
+	releaseStreamStorage(stream);
+	stream.regionSize = 0;
+}
+
+// Move to the next region, waiting only if the GPU is still reading it from kStreamFramesInFlight frames ago
+void beginStreamFrame(StreamBuffer& stream) {
+	stream.region = (stream.region + 1) % kStreamFramesInFlight;
+	stream.offset = 0;
+	waitStreamFence(stream.fences[stream.region]);
+}
+
+// Fence the current region once every draw that reads it has been submitted. A frame that
+// streamed nothing leaves no fence, so reusing its region later does not wait.
+void endStreamFrame(StreamBuffer& stream) {
+	if (stream.offset == 0) return;
+	stream.fences[stream.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// Suballocate size bytes from the current frame's region. When the region is exhausted the
+// ring is recreated with larger regions; the old storage is orphaned, not waited on.
+StreamAllocation allocStream(StreamBuffer& stream, size_t size, size_t alignment) {
+	size_t offset = (stream.offset + alignment - 1) / alignment * alignment;
+	if (offset + size > stream.regionSize) {
+		size_t regionSize = stream.regionSize ? stream.regionSize : 64 * 1024;
+		while (regionSize < size) regionSize *= 2;
+		regionSize *= 2;
+		releaseStreamStorage(stream);
+		createStreamStorage(stream, regionSize);
+		offset = 0;
+	}
+	stream.offset = offset + size;
+	
+	StreamAllocation alloc;
+	alloc.offset = (size_t)stream.region * stream.regionSize + offset;
+	alloc.size = size;
+	if (stream.persistent) {
+		alloc.ptr = stream.mapped + alloc.offset;
+	} else {
+		// The fences already keep this range away from the GPU, so skip the driver's own sync
+		glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+		alloc.ptr = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)alloc.offset, (GLsizeiptr)size,
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	}
+	return alloc;
+}
+
+// Finish writing an allocation (a no-op for the coherent persistent mapping)
+void commitStream(StreamBuffer& stream, const StreamAllocation& alloc) {
+	if (!stream.persistent && alloc.ptr) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
+}
+
+// Copy data into the stream and return where it landed; ptr is NULL if mapping failed
+static StreamAllocation streamUpload(StreamBuffer& stream, const void* data, size_t size, size_t alignment) {
+	StreamAllocation alloc = allocStream(stream, size, alignment);
+	if (alloc.ptr) {
+		memcpy(alloc.ptr, data, size);
+		commitStream(stream, alloc);
+	}
+	return alloc;
+}
+
+const uint32_t kReplacementCharacter = 0xFFFD;
+
+// Decode one multibyte sequence starting at text[i]. Invalid, overlong and surrogate
+// sequences produce U+FFFD and consume a single byte so decoding resynchronizes.
+static uint32_t decodeUtf8Sequence(const unsigned char* text, size_t length, size_t& i) {
+	unsigned char lead = text[i];
+	int extra;
+	uint32_t cp, minValue;
+	if ((lead & 0xE0) == 0xC0) { extra = 1; cp = lead & 0x1F; minValue = 0x80; }
+	else if ((lead & 0xF0) == 0xE0) { extra = 2; cp = lead & 0x0F; minValue = 0x800; }
+	else if ((lead & 0xF8) == 0xF0) { extra = 3; cp = lead & 0x07; minValue = 0x10000; }
+	else { i++; return kReplacementCharacter; }
+	
+	if (i + extra >= length) { i++; return kReplacementCharacter; }
+	for (int k = 1; k <= extra; k++) {
+		unsigned char cont = text[i + k];
+		if ((cont & 0xC0) != 0x80) { i++; return kReplacementCharacter; }
+		cp = (cp << 6) | (cont & 0x3F);
+	}
+	if (cp < minValue || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) { i++; return kReplacementCharacter; }
+	i += extra + 1;
+	return cp;
+}
+
+// Scalar reference decoder, also used for the tail and for multibyte runs of decodeUtf8
+static size_t decodeUtf8Scalar(const unsigned char* text, size_t length, size_t i, uint32_t* out) {
+	size_t n = 0;
+	while (i < length) {
+		if (text[i] < 0x80) {
+			out[n++] = text[i++];
+		} else {
+			out[n++] = decodeUtf8Sequence(text, length, i);
+		}
+	}
+	return n;
+}
+
+// Decode UTF-8 into codepoints appended to out. Runs of pure ASCII are detected 16 bytes at
+// a time and widened with SIMD stores; only multibyte sequences go through the scalar decoder.
+size_t decodeUtf8(const std::string& text, std::vector<uint32_t>& out) {
+	const unsigned char* src = (const unsigned char*)text.data();
+	const size_t length = text.size();
+	const size_t base = out.size();
+	out.resize(base + length);  // Never more codepoints than bytes
+	uint32_t* dst = out.data() + base;
+	size_t n = 0;
+	size_t i = 0;
+	
+	while (i < length) {
+#if defined(TEXT_SIMD_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		while (i + 16 <= length) {
+			__m128i bytes = _mm_loadu_si128((const __m128i*)(src + i));
+			if (_mm_movemask_epi8(bytes) != 0) break;
+			__m128i lo = _mm_unpacklo_epi8(bytes, zero);
+			__m128i hi = _mm_unpackhi_epi8(bytes, zero);
+			_mm_storeu_si128((__m128i*)(dst + n + 0), _mm_unpacklo_epi16(lo, zero));
+			_mm_storeu_si128((__m128i*)(dst + n + 4), _mm_unpackhi_epi16(lo, zero));
+			_mm_storeu_si128((__m128i*)(dst + n + 8), _mm_unpacklo_epi16(hi, zero));
+			_mm_storeu_si128((__m128i*)(dst + n + 12), _mm_unpackhi_epi16(hi, zero));
+			i += 16;
+			n += 16;
+		}
+#elif defined(TEXT_SIMD_NEON)
+		while (i + 16 <= length) {
+			uint8x16_t bytes = vld1q_u8(src + i);
+			if (vmaxvq_u8(bytes) >= 0x80) break;
+			uint16x8_t lo = vmovl_u8(vget_low_u8(bytes));
+			uint16x8_t hi = vmovl_u8(vget_high_u8(bytes));
+			vst1q_u32(dst + n + 0, vmovl_u16(vget_low_u16(lo)));
+			vst1q_u32(dst + n + 4, vmovl_u16(vget_high_u16(lo)));
+			vst1q_u32(dst + n + 8, vmovl_u16(vget_low_u16(hi)));
+			vst1q_u32(dst + n + 12, vmovl_u16(vget_high_u16(hi)));
+			i += 16;
+			n += 16;
+		}
+#endif
+		if (i >= length) break;
+		
+		// Scalar until the next 16-byte boundary of input is worth another SIMD attempt
+		size_t stop = (length - i > 16) ? i + 16 : length;
+		while (i < stop) {
+			if (src[i] < 0x80) {
+				dst[n++] = src[i++];
+			} else {
+				dst[n++] = decodeUtf8Sequence(src, length, i);
+			}
+		}
+	}
+	
+	out.resize(base + n);
+	return n;
+}
+
+// Per-thread scratch so layout does not allocate for every string
+static std::vector<uint32_t>& decodeTextScratch(const std::string& text) {
+	static thread_local std::vector<uint32_t> codepoints;
+	codepoints.clear();
+	decodeUtf8(text, codepoints);
+	return codepoints;
+}
+
+// Codepoints that produce no glyph: C0/C1 controls and DEL
+inline bool isControlCodepoint(uint32_t cp) {
+	return cp < 32 || (cp >= 127 && cp < 160);
+}
+
+static inline uint16_t packUnorm16(float v) {
+	if (v <= 0.0f) return 0;
+	if (v >= 1.0f) return 65535;
+	return (uint16_t)(v * 65535.0f + 0.5f);
+}
+
+static void pushGlyphQuad(TextBatch& batch, float x0, float y0, float x1, float y1,
+						  float u0, float v0, float u1, float v1, uint32_t color) {
+	const TextRect& clip = batch.clip;
+	if (x1 <= clip.x0 || x0 >= clip.x1 || y1 <= clip.y0 || y0 >= clip.y1) return;
+	
+	if (batch.pipeline == TextPipeline::Instanced) {
+		batch.instances.push_back({ x0, y0, x1, y1,
+			packUnorm16(u0), packUnorm16(v0), packUnorm16(u1), packUnorm16(v1), color });
+		return;
+	}
+	batch.vertices.push_back({ x0, y1, u0, v1, color });
+	batch.vertices.push_back({ x1, y1, u1, v1, color });
+	batch.vertices.push_back({ x1, y0, u1, v0, color });
+	batch.vertices.push_back({ x0, y0, u0, v0, color });
+}
+
+// Codepoints decodeUtf8 yields for the first byteOffset bytes of a UTF-8 string. Steps the
+// way the decoder does, so an invalid or truncated byte counts as its own U+FFFD. An offset
+// inside a sequence counts that sequence.
+static size_t codepointIndex(const std::string& text, size_t byteOffset) {
+	const unsigned char* bytes = (const unsigned char*)text.data();
+	size_t end = std::min(byteOffset, text.size());
+	size_t n = 0;
+	for (size_t i = 0; i < end; n++) {
+		if (bytes[i] < 0x80) {
+			i++;
+		} else {
+			decodeUtf8Sequence(bytes, text.size(), i);
+		}
+	}
+	return n;
+}
+
+// Shared by queueText and queueColoredText; spans must be sorted by start
+static void queueTextSpans(TextBatch& batch, const std::string& text, const TextColorSpan* spans, size_t spanCount,
+						   float x, float y, float scale, TextRenderer& renderer) {
+	if (text.empty()) return;
+	
+	// Glyphs already queued keep their format; a pipeline switch takes effect on the next flush
+	if (batch.vertices.empty() && batch.instances.empty()) {
+		batch.pipeline = renderer.pipeline;
+	}
+	
+	float currentX = x;
+	
+	// Color of codepoint i, advancing through the spans as the string is walked
+	uint32_t color = batch.color;
+	size_t span = 0;
+	size_t spanStart = spanCount ? codepointIndex(text, spans[0].start) : SIZE_MAX;
+	auto colorAt = [&](size_t i) {
+		while (i >= spanStart) {
+			color = spans[span++].color;
+			spanStart = (span < spanCount) ? codepointIndex(text, spans[span].start) : SIZE_MAX;
+		}
+		return color;
+	};
+	const std::vector<uint32_t>& codepoints = decodeTextScratch(text);
+	
+	// Use TTF glyphs if available
+	if (!renderer.faces.empty()) {
+		const bool vector = (renderer.atlasMode == AtlasMode::Vector);
+		const float invAtlasWidth = 1.0f / (float)renderer.fontTextureWidth;
+		const float invAtlasHeight = 1.0f / (float)renderer.fontTextureHeight;
+		const float kernScale = scale * (1.0f / 64.0f);
+		uint32_t prev = 0;
+		for (size_t i = 0; i < codepoints.size(); i++) {
+			uint32_t c = codepoints[i];
+			if (isControlCodepoint(c)) continue;
+			
+			const Glyph* glyph = acquireGlyph(renderer, c);
+			if (!glyph) continue;
+			
+			currentX += findKerning(renderer.kerning, prev, c) * kernScale;
+			prev = c;
+			
+			// With subpixel variants the pen snaps to a whole pixel and the variant rasterized
+			// nearest to the remainder is drawn instead (exact at scale 1)
+			float penX = currentX;
+			int atlasX = glyph->x;
+			if (renderer.subpixelPhases > 1) {
+				float whole = floorf(currentX);
+				int phase = (int)((currentX - whole) * renderer.subpixelPhases + 0.5f);
+				if (phase == renderer.subpixelPhases) {
+					whole += 1.0f;
+					phase = 0;
+				}
+				penX = whole;
+				atlasX += phase * glyphCellStride(glyph->width);
+			}
+			
+			float charX = penX + glyph->xoff * scale;
+			float charY = y + glyph->yoff * scale;
+			float charWidth = glyph->width * scale;
+			float charHeight = glyph->height * scale;
+			
+			if (glyph->width > 0 && glyph->height > 0 && vector) {
+				// Both UV corners carry the outline record (x low, y high 16 bits); the
+				// vertex shader looks up the glyph's own coordinates from it
+				float recordLow = glyph->x * (1.0f / 65535.0f);
+				float recordHigh = glyph->y * (1.0f / 65535.0f);
+				pushGlyphQuad(batch, charX, charY, charX + charWidth, charY + charHeight,
+							  recordLow, recordHigh, recordLow, recordHigh, colorAt(i));
+			} else if (glyph->width > 0 && glyph->height > 0) {
+				pushGlyphQuad(batch, charX, charY, charX + charWidth, charY + charHeight,
+							  atlasX * invAtlasWidth, glyph->y * invAtlasHeight,
+							  (atlasX + glyph->width) * invAtlasWidth, (glyph->y + glyph->height) * invAtlasHeight, colorAt(i));
+			}
+			
+			currentX += glyphAdvance(*glyph) * scale;
+		}
+	} else {
+		// Fallback to bitmap font
+		float charWidth = 8.0f * scale;
+		float charHeight = 8.0f * scale;
+		float charSpacing = 2.0f * scale;
+		const int charsPerRow = 16;
+		const int numRows = 8;
+		
+		for (size_t i = 0; i < codepoints.size(); i++) {
+			uint32_t c = codepoints[i];
+			if (c < 32 || c >= 127) continue;
+			
+			int charIndex = (int)c - 32;
+			int texRow = charIndex / charsPerRow;
+			int texCol = charIndex % charsPerRow;
+			
+			float texLeft = (float)texCol / charsPerRow;
+			float texRight = (float)(texCol + 1) / charsPerRow;
+			float texTop = (float)texRow / numRows;
+			float texBottom = (float)(texRow + 1) / numRows;
+			
+			pushGlyphQuad(batch, currentX, y, currentX + charWidth, y + charHeight,
+						  texLeft, texTop, texRight, texBottom, colorAt(i));
+			
+			currentX += charWidth + charSpacing;
+		}
+	}
+}
+
+// Lay out a string in batch.color and append its glyph quads; nothing is sent to GL here
+void queueText(TextBatch& batch, const std::string& text, float x, float y, float scale, TextRenderer& renderer) {
+	queueTextSpans(batch, text, NULL, 0, x, y, scale, renderer);
+}
+
+// As queueText, with the color switching at each span. Text before the first span uses batch.color.
+void queueColoredText(TextBatch& batch, const std::string& text, const std::vector<TextColorSpan>& spans,
+					  float x, float y, float scale, TextRenderer& renderer) {
+	queueTextSpans(batch, text, spans.data(), spans.size(), x, y, scale, renderer);
+}
+
+// Grow the shared quad index buffer so it covers at least quadCount quads
+static void ensureQuadIndices(TextRenderer& renderer, size_t quadCount) {
+	if (quadCount <= renderer.indexQuadCapacity) return;
+	
+	size_t capacity = renderer.indexQuadCapacity ? renderer.indexQuadCapacity : 256;
+	while (capacity < quadCount) capacity *= 2;
+	
+	std::vector<unsigned int> indices(capacity * 6);
+	for (size_t q = 0; q < capacity; q++) {
+		unsigned int base = (unsigned int)(q * 4);
+		indices[q * 6 + 0] = base + 0;
+		indices[q * 6 + 1] = base + 1;
+		indices[q * 6 + 2] = base + 2;
+		indices[q * 6 + 3] = base + 2;
+		indices[q * 6 + 4] = base + 3;
+		indices[q * 6 + 5] = base + 0;
+	}
+	
+	glBindVertexArray(renderer.vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	renderer.indexQuadCapacity = capacity;
+}
+
+// Bind the program and font texture of a pipeline and set its per-frame uniforms
+static void bindTextProgram(TextRenderer& renderer, TextPipeline pipeline) {
+	bool instanced = (pipeline == TextPipeline::Instanced);
+	glUseProgram(instanced ? renderer.instanceProgram : renderer.program);
+	glActiveTexture(GL_TEXTURE0);
+	if (renderer.atlasMode == AtlasMode::Vector) {
+		glBindTexture(GL_TEXTURE_BUFFER, renderer.outlines.texture);
+	} else {
+		glBindTexture(GL_TEXTURE_2D, renderer.fontTexture);
+	}
+	glUniform1i(instanced ? renderer.instanceFontTextureLoc : renderer.fontTextureLoc, 0);
+	glUniform2f(instanced ? renderer.instanceScreenSizeLoc : renderer.screenSizeLoc,
+				(float)renderer.windowWidth, (float)renderer.windowHeight);
+}
+
+// Instanced path: one instance per glyph, drawn as a 4-vertex triangle strip
+static void flushTextBatchInstanced(TextBatch& batch, TextRenderer& renderer) {
+	bindTextProgram(renderer, TextPipeline::Instanced);
+	glBindVertexArray(renderer.instanceVao);
+	
+	size_t bytes = batch.instances.size() * sizeof(GlyphInstance);
+	size_t base = 0;
+	StreamAllocation alloc = {};
+	if (renderer.stream) alloc = streamUpload(*renderer.stream, batch.instances.data(), bytes, sizeof(GlyphInstance));
+	if (alloc.ptr) {
+		glBindBuffer(GL_ARRAY_BUFFER, renderer.stream->buffer);
+		base = alloc.offset;
+	} else {
+		glBindBuffer(GL_ARRAY_BUFFER, renderer.instanceVbo);
+		glBufferData(GL_ARRAY_BUFFER, bytes, batch.instances.data(), GL_DYNAMIC_DRAW);
+	}
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), (void*)(base + offsetof(GlyphInstance, x0)));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(GlyphInstance), (void*)(base + offsetof(GlyphInstance, u0)));
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphInstance), (void*)(base + offsetof(GlyphInstance, color)));
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)batch.instances.size());
+	
+	batch.instances.clear();
+}
+
+// Upload every queued quad at once, draw them with one call and reset the batch
+void flushTextBatch(TextBatch& batch, TextRenderer& renderer) {
+	uploadGlyphCache(renderer);
+	if (!batch.instances.empty()) {
+		flushTextBatchInstanced(batch, renderer);
+	}
+	if (batch.vertices.empty()) return;
+	
+	size_t quadCount = batch.vertices.size() / 4;
+	ensureQuadIndices(renderer, quadCount);
+	
+	bindTextProgram(renderer, TextPipeline::Quads);
+	glBindVertexArray(renderer.vao);
+	
+	size_t bytes = batch.vertices.size() * sizeof(TextVertex);
+	size_t base = 0;
+	StreamAllocation alloc = {};
+	if (renderer.stream) alloc = streamUpload(*renderer.stream, batch.vertices.data(), bytes, sizeof(TextVertex));
+	if (alloc.ptr) {
+		glBindBuffer(GL_ARRAY_BUFFER, renderer.stream->buffer);
+		base = alloc.offset;
+	} else {
+		glBindBuffer(GL_ARRAY_BUFFER, renderer.vbo);
+		glBufferData(GL_ARRAY_BUFFER, bytes, batch.vertices.data(), GL_DYNAMIC_DRAW);
+	}
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)(base + offsetof(TextVertex, x)));
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)(base + offsetof(TextVertex, u)));
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextVertex), (void*)(base + offsetof(TextVertex, color)));
+	glDrawElements(GL_TRIANGLES, (GLsizei)(quadCount * 6), GL_UNSIGNED_INT, 0);
+	
+	batch.vertices.clear();
+}
+
+// Advance and ink box of a glyph without rasterizing it or touching the cache: the table
+// entry when there is one, otherwise the font metrics cacheGlyph would store. The box of a
+// coverage glyph leaves out the subpixel phases, which lineBoxVisible's slack covers.
+static void glyphMetrics(const TextRenderer& renderer, uint32_t codepoint, Glyph& metrics) {
+	const Glyph* glyph = findGlyph(renderer.glyphs, codepoint);
+	if (glyph) {
+		metrics = *glyph;
+		return;
+	}
+	
+	memset(&metrics, 0, sizeof(metrics));
+	FaceGlyph resolved = resolveFaceGlyph(renderer.faces, codepoint);
+	if (resolved.face < 0) return;
+	const FontFace& face = renderer.faces[resolved.face];
+	
+	int advance, lsb;
+	stbtt_GetGlyphHMetrics(&face.info, resolved.glyphIndex, &advance, &lsb);
+	metrics.advance = (uint16_t)lroundf((float)advance * face.scale * 64.0f);
+	
+	int x0, y0, x1, y1;
+	stbtt_GetGlyphBitmapBox(&face.info, resolved.glyphIndex, face.scale, face.scale, &x0, &y0, &x1, &y1);
+	if (x1 <= x0 || y1 <= y0) return;
+	
+	// Distance fields carry their padding, outline quads a pixel of margin
+	int pad = 0;
+	if (renderer.atlasMode == AtlasMode::DistanceField) pad = kSdfPadding;
+	else if (renderer.atlasMode == AtlasMode::Vector) pad = 1;
+	metrics.xoff = (int16_t)(x0 - pad);
+	metrics.yoff = (int16_t)(y0 - pad);
+	metrics.width = (uint16_t)(x1 - x0 + 2 * pad);
+	metrics.height = (uint16_t)(y1 - y0 + 2 * pad);
+}
+
+// Advance and ink box of a string at scale 1, following the same steps as queueText. Only
+// metrics are read, so measuring lines that end up culled rasterizes and evicts nothing.
+TextLineBox measureTextLine(const std::string& text, const TextRenderer& renderer) {
+	TextLineBox box = { 0.0f, FLT_MAX, -FLT_MAX, FLT_MAX, -FLT_MAX };
+	if (!renderer.faces.empty()) {
+		float x = 0.0f;
+		uint32_t prev = 0;
+		Glyph glyph;
+		for (uint32_t c : decodeTextScratch(text)) {
+			if (isControlCodepoint(c)) continue;
+			glyphMetrics(renderer, c, glyph);
+			
+			x += findKerning(renderer.kerning, prev, c) * (1.0f / 64.0f);
+			prev = c;
+			if (glyph.width > 0 && glyph.height > 0) {
+				box.left = std::min(box.left, x + glyph.xoff);
+				box.right = std::max(box.right, x + glyph.xoff + glyph.width);
+				box.top = std::min(box.top, (float)glyph.yoff);
+				box.bottom = std::max(box.bottom, (float)(glyph.yoff + glyph.height));
+			}
+			x += glyphAdvance(glyph);
+		}
+		box.advance = x;
+	} else {
+		size_t printable = 0;
+		for (uint32_t c : decodeTextScratch(text)) {
+			if (c >= 32 && c < 127) printable++;
+		}
+		box.advance = 10.0f * (float)printable;
+		if (printable) {
+			box.left = 0.0f;
+			box.right = box.advance;
+			box.top = 0.0f;
+			box.bottom = 8.0f;
+		}
+	}
+	
+	// No ink: an empty box at the origin
+	if (box.left > box.right) {
+		box.left = box.right = box.top = box.bottom = 0.0f;
+	}
+	return box;
+}
+
+// True when the retained geometry no longer matches the renderer state it was built for
+bool textLayoutNeedsBuild(const TextLayout& layout, const TextRenderer& renderer) {
+	return layout.dirty || layout.width != renderer.windowWidth || layout.height != renderer.windowHeight ||
+		   layout.pipeline != renderer.pipeline || layout.atlasGeneration != renderer.glyphCache.generation;
+}
+
+// Line boxes of a block, measured again only when the glyph metrics may have changed
+static const std::vector<TextLineBox>& textBlockLineBoxes(TextBlock& block, TextRenderer& renderer) {
+	if (block.lineBoxes.size() != block.lines.size() || block.lineBoxGeneration != renderer.metricsGeneration) {
+		block.lineBoxes.resize(block.lines.size());
+		for (size_t i = 0; i < block.lines.size(); i++) {
+			block.lineBoxes[i] = measureTextLine(block.lines[i], renderer);
+		}
+		block.lineBoxGeneration = renderer.metricsGeneration;
+	}
+	return block.lineBoxes;
+}
+
+// O(1) line rejection; the 1px slack covers the pen snapping of subpixel variants
+static inline bool lineBoxVisible(const TextLineBox& box, float x, float y, float scale, const TextRect& clip) {
+	return x + box.left * scale - 1.0f < clip.x1 && x + box.right * scale + 1.0f > clip.x0 &&
+		   y + box.top * scale < clip.y1 && y + box.bottom * scale > clip.y0;
+}
+
+// Place the lines of a block; lines whose box misses batch.clip never reach queueText
+static void queueBlockLine(TextBatch& batch, const TextBlock& block, size_t line, float x, float y,
+						   TextRenderer& renderer) {
+	if (line < block.lineSpans.size() && !block.lineSpans[line].empty()) {
+		queueColoredText(batch, block.lines[line], block.lineSpans[line], x, y, block.scale, renderer);
+	} else {
+		queueText(batch, block.lines[line], x, y, block.scale, renderer);
+	}
+}
+
+static void layoutTextBlock(TextBatch& batch, TextBlock& block, TextRenderer& renderer) {
+	const std::vector<TextLineBox>& boxes = textBlockLineBoxes(block, renderer);
+	batch.color = block.color;
+	
+	if (block.flow == TextFlow::Stacked) {
+		float y = block.y;
+		for (size_t i = 0; i < block.lines.size(); i++) {
+			if (lineBoxVisible(boxes[i], block.x, y, block.scale, batch.clip)) {
+				queueBlockLine(batch, block, i, block.x, y, renderer);
+			}
+			y += block.lineHeight;
+		}
+		return;
+	}
+	
+	// Columns keep wrapping leftwards past the window edge; those lines are culled below
+	// rather than drawn over the first column
+	float y = block.y;
+	float currentRightEdge = block.x;
+	float maxColWidth = 0.0f;
+	for (size_t i = 0; i < block.lines.size(); i++) {
+		if (y + block.lineHeight > block.bottomLimit) {
+			currentRightEdge -= (maxColWidth + block.columnPadding);
+			y = block.y;
+			maxColWidth = 0.0f;
+		}
+		
+		float textWidth = boxes[i].advance * block.scale;
+		if (textWidth > maxColWidth) maxColWidth = textWidth;
+		float startX = currentRightEdge - textWidth;
+		if (lineBoxVisible(boxes[i], startX, y, block.scale, batch.clip)) {
+			queueBlockLine(batch, block, i, startX, y, renderer);
+		}
+		y += block.lineHeight;
+	}
+}
+
+static size_t textBatchGlyphCount(const TextBatch& batch) {
+	return (batch.pipeline == TextPipeline::Instanced) ? batch.instances.size() : batch.vertices.size() / 4;
+}
+
+// Append a slot's glyphs to the batch, cut or padded with degenerate quads to exactly maxGlyphs
+static void queueTextSlot(TextBatch& batch, const TextSlot& slot, TextRenderer& renderer) {
+	size_t base = textBatchGlyphCount(batch);
+	batch.color = slot.color;
+	queueTextSpans(batch, slot.text, slot.spans.data(), slot.spans.size(), slot.x, slot.y, slot.scale, renderer);
+	
+	size_t end = base + slot.maxGlyphs;
+	if (batch.pipeline == TextPipeline::Instanced) {
+		batch.instances.resize(end, GlyphInstance());
+	} else {
+		batch.vertices.resize(end * 4, TextVertex());
+	}
+}
+
+// Reserve a dynamic region of maxGlyphs glyphs; returns the slot index for updateTextSlot
+size_t addTextSlot(TextLayout& layout, size_t maxGlyphs) {
+	TextSlot slot;
+	slot.maxGlyphs = maxGlyphs;
+	layout.slots.push_back(slot);
+	layout.dirty = true;
+	return layout.slots.size() - 1;
+}
+
+// Queue slots [first, first + count) again and rewrite their region with one glBufferSubData.
+// The static glyphs stay on the GPU untouched. Returns false when the layout needs a full
+// build instead; that build writes the slots' current contents.
+static bool writeTextSlots(TextLayout& layout, size_t first, size_t count, TextRenderer& renderer) {
+	if (count == 0) return true;
+	if (textLayoutNeedsBuild(layout, renderer)) return false;
+	
+	TextBatch& batch = layout.slotGeometry;
+	batch.vertices.clear();
+	batch.instances.clear();
+	batch.pipeline = layout.pipeline;
+	batch.clip = { 0.0f, 0.0f, (float)renderer.windowWidth, (float)renderer.windowHeight };
+	renderer.glyphCache.touchedPages = 0;
+	renderer.glyphCache.deferred = false;
+	for (size_t i = first; i < first + count; i++) {
+		queueTextSlot(batch, layout.slots[i], renderer);
+	}
+	layout.cachePages |= renderer.glyphCache.touchedPages;
+	
+	// A new glyph evicted others: the static UVs are stale and the next build rewrites everything.
+	// A glyph left out for lack of room is retried by that build too.
+	if (renderer.glyphCache.deferred) layout.dirty = true;
+	if (layout.atlasGeneration != renderer.glyphCache.generation || layout.dirty) return false;
+	
+	// Slots are laid out back to back, so the range is contiguous
+	size_t base = layout.slots[first].base;
+	uploadGlyphCache(renderer);
+	glBindBuffer(GL_ARRAY_BUFFER, layout.vbo);
+	if (layout.pipeline == TextPipeline::Instanced) {
+		glBufferSubData(GL_ARRAY_BUFFER, base * sizeof(GlyphInstance),
+						batch.instances.size() * sizeof(GlyphInstance), batch.instances.data());
+	} else {
+		glBufferSubData(GL_ARRAY_BUFFER, base * 4 * sizeof(TextVertex),
+						batch.vertices.size() * sizeof(TextVertex), batch.vertices.data());
+	}
+	return true;
+}
+
+// Change a slot's text and rewrite only its region with glBufferSubData. Returns true when
+// the text changed.
+bool updateTextSlot(TextLayout& layout, size_t index, const std::string& text, TextRenderer& renderer) {
+	TextSlot& slot = layout.slots[index];
+	if (slot.text == text) return false;
+	slot.text = text;
+	writeTextSlots(layout, index, 1, renderer);
+	return true;
+}
+
+// Lay out every block and upload the result once into the layout's static buffer
+void buildTextLayout(TextLayout& layout, TextRenderer& renderer) {
+	renderer.glyphCache.touchedPages = 0;
+	renderer.glyphCache.deferred = false;
+	layout.geometry.vertices.clear();
+	layout.geometry.instances.clear();
+	layout.geometry.pipeline = renderer.pipeline;
+	for (auto& block : layout.blocks) {
+		TextRect clip = { 0.0f, 0.0f, (float)renderer.windowWidth, (float)renderer.windowHeight };
+		if (block.clip.x1 > block.clip.x0) {
+			clip.x0 = std::max(clip.x0, block.clip.x0);
+			clip.y0 = std::max(clip.y0, block.clip.y0);
+			clip.x1 = std::min(clip.x1, block.clip.x1);
+			clip.y1 = std::min(clip.y1, block.clip.y1);
+		}
+		layout.geometry.clip = clip;
+		layoutTextBlock(layout.geometry, block, renderer);
+	}
+	layout.geometry.clip = { 0.0f, 0.0f, (float)renderer.windowWidth, (float)renderer.windowHeight };
+	for (auto& slot : layout.slots) {
+		slot.base = textBatchGlyphCount(layout.geometry);
+		queueTextSlot(layout.geometry, slot, renderer);
+	}
+	
+	if (!layout.vao) {
+		glGenVertexArrays(1, &layout.vao);
+		glGenBuffers(1, &layout.vbo);
+	}
+	
+	uploadGlyphCache(renderer);
+	
+	layout.pipeline = layout.geometry.pipeline;
+	layout.width = renderer.windowWidth;
+	layout.height = renderer.windowHeight;
+	layout.atlasGeneration = renderer.glyphCache.generation;
+	layout.cachePages = renderer.glyphCache.touchedPages;
+	layout.dirty = renderer.glyphCache.deferred;  // Build again next frame for glyphs that found no room
+	
+	glBindVertexArray(layout.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, layout.vbo);
+	if (layout.pipeline == TextPipeline::Instanced) {
+		layout.glyphCount = layout.geometry.instances.size();
+		glBufferData(GL_ARRAY_BUFFER, layout.glyphCount * sizeof(GlyphInstance), layout.geometry.instances.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, x0));
+		glEnableVertexAttribArray(0);
+		glVertexAttribDivisor(0, 1);
+		glVertexAttribPointer(1, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, u0));
+		glEnableVertexAttribArray(1);
+		glVertexAttribDivisor(1, 1);
+		glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, color));
+		glEnableVertexAttribArray(2);
+		glVertexAttribDivisor(2, 1);
+	} else {
+		layout.glyphCount = layout.geometry.vertices.size() / 4;
+		glBufferData(GL_ARRAY_BUFFER, layout.geometry.vertices.size() * sizeof(TextVertex), layout.geometry.vertices.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, x));
+		glEnableVertexAttribArray(0);
+		glVertexAttribDivisor(0, 0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, u));
+		glEnableVertexAttribArray(1);
+		glVertexAttribDivisor(1, 0);
+		glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextVertex), (void*)offsetof(TextVertex, color));
+		glEnableVertexAttribArray(2);
+		glVertexAttribDivisor(2, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.ebo);
+	}
+	glBindVertexArray(0);
+	ensureQuadIndices(renderer, layout.glyphCount);
+}
+
+// Mark the cache pages a layout samples as used this frame, so no eviction pulls texels from
+// under geometry that is not rebuilt. Call before anything else may evict in a frame the
+// layout is drawn; drawTextLayout does it too.
+void touchTextLayout(const TextLayout& layout, TextRenderer& renderer) {
+	for (int p = 0; p < kGlyphCachePages; p++) {
+		if (layout.cachePages & (1u << p)) renderer.glyphCache.pages[p].lastUsed = renderer.frame;
+	}
+}
+
+// Draw retained geometry: one VAO bind and one draw call
+void drawTextLayout(const TextLayout& layout, TextRenderer& renderer) {
+	if (layout.glyphCount == 0) return;
+	
+	touchTextLayout(layout, renderer);
+	bindTextProgram(renderer, layout.pipeline);
+	glBindVertexArray(layout.vao);
+	if (layout.pipeline == TextPipeline::Instanced) {
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)layout.glyphCount);
+	} else {
+		glDrawElements(GL_TRIANGLES, (GLsizei)(layout.glyphCount * 6), GL_UNSIGNED_INT, 0);
+	}
+}
+
+void destroyTextLayout(TextLayout& layout) {
+	glDeleteVertexArrays(1, &layout.vao);
+	glDeleteBuffers(1, &layout.vbo);
+	layout.vao = 0;
+	layout.vbo = 0;
+	layout.glyphCount = 0;
+	layout.dirty = true;
+}
+
+// Rows that fit the view whole; the list scrolls in row steps so no row is cut at an edge
+static size_t textListVisibleRows(const TextList& list) {
+	float rows = floorf((list.view.y1 - list.view.y0) / list.rowHeight);
+	return rows > 0.0f ? (size_t)rows : 0;
+}
+
+static float clampTextListScroll(const TextList& list, float scroll) {
+	size_t visible = textListVisibleRows(list);
+	float maxRow = (list.rows.size() > visible) ? (float)(list.rows.size() - visible) : 0.0f;
+	float row = std::min(std::max(floorf(scroll / list.rowHeight + 0.5f), 0.0f), maxRow);
+	return row * list.rowHeight;
+}
+
+// Scroll by delta pixels (positive moves the content up), snapped to whole rows
+void scrollTextList(TextList& list, float delta) {
+	list.scroll = clampTextListScroll(list, list.scroll + delta);
+}
+
+// Pen advance of a row at scale 1, measured once per font rather than on every scroll
+static float textListRowAdvance(TextList& list, size_t row, TextRenderer& renderer) {
+	if (list.rowAdvances[row] < 0.0f) {
+		list.rowAdvances[row] = measureTextLine(list.rows[row], renderer).advance;
+	}
+	return list.rowAdvances[row];
+}
+
+// Fill the row slots for the current scroll position. While the view keeps its size the
+// slots keep theirs, so a scroll rewrites the list's buffer in place; only a view resize or a
+// renderer change (pipeline, atlas) builds it again. Returns true when the geometry changed.
+bool updateTextList(TextList& list, TextRenderer& renderer) {
+	// The view may have been resized since the last scroll
+	list.scroll = clampTextListScroll(list, list.scroll);
+	
+	// Visible rows follow directly from the uniform row height
+	size_t visible = textListVisibleRows(list);
+	size_t first = std::min((size_t)(list.scroll / list.rowHeight + 0.5f), list.rows.size());
+	size_t last = std::min(first + visible, list.rows.size());
+	
+	// Every slot can hold the longest row, so any row fits any slot
+	if (list.rowAdvances.size() != list.rows.size()) {
+		list.rowGlyphs = 0;
+		for (const auto& row : list.rows) list.rowGlyphs = std::max(list.rowGlyphs, decodeTextScratch(row).size());
+	}
+	if (list.rowAdvances.size() != list.rows.size() || list.rowAdvanceGeneration != renderer.metricsGeneration) {
+		list.rowAdvances.assign(list.rows.size(), -1.0f);
+		list.rowAdvanceGeneration = renderer.metricsGeneration;
+	}
+	
+	TextLayout& layout = list.layout;
+	if (layout.slots.size() != visible || (visible && layout.slots[0].maxGlyphs != list.rowGlyphs)) {
+		layout.slots.assign(visible, TextSlot());
+		for (auto& slot : layout.slots) slot.maxGlyphs = list.rowGlyphs;
+		layout.dirty = true;
+	}
 	
-	std::vector<unsigned char> fontBuffer(size);
-	if (!file.read((char*)fontBuffer.data(), size)) {
+	bool build = textLayoutNeedsBuild(layout, renderer);
+	if (!build && first == list.first && last == list.last && list.scroll == list.builtScroll) {
 		return false;
 	}
-	file.close();
 	
-	stbtt_fontinfo font;
-	if (!stbtt_InitFont(&font, fontBuffer.data(), stbtt_GetFontOffsetForIndex(fontBuffer.data(), 0))) {
-		return false;
+	for (size_t i = 0; i < visible; i++) {
+		TextSlot& slot = layout.slots[i];
+		size_t row = first + i;
+		if (row < last) {
+			slot.text = list.rows[row];
+			if (row < list.rowSpans.size()) {
+				slot.spans = list.rowSpans[row];
+			} else {
+				slot.spans.clear();
+			}
+			slot.x = list.view.x1 - textListRowAdvance(list, row, renderer) * list.scale;
+		} else {
+			slot.text.clear();
+			slot.spans.clear();
+		}
+		slot.y = list.view.y0 + (float)i * list.rowHeight + list.baseline;
+		slot.scale = list.scale;
 	}
 	
-	float scale = stbtt_ScaleForPixelHeight(&font, fontSize);
-	renderer.fontScale = scale;
-	renderer.fontSize = fontSize;
+	if (build || !writeTextSlots(layout, 0, visible, renderer)) {
+		buildTextLayout(layout, renderer);
+	}
+	list.first = first;
+	list.last = last;
+	list.builtScroll = list.scroll;
+	return true;
+}
+
+// Draw the list's rows scissored to its view. Culling only drops glyphs wholly outside it, so
+// a row wider than the view, or a glyph across an edge, is cut here at the exact pixel.
+void drawTextList(const TextList& list, TextRenderer& renderer) {
+	int x0 = (int)floorf(list.view.x0);
+	int x1 = (int)ceilf(list.view.x1);
+	int y0 = (int)floorf(list.view.y0);
+	int y1 = (int)ceilf(list.view.y1);
+	if (x1 <= x0 || y1 <= y0) return;
 	
-	const int atlasWidth = 512;
-	const int atlasHeight = 512;
-	unsigned char* atlasData = new unsigned char[atlasWidth * atlasHeight];
-	memset(atlasData, 0, atlasWidth * atlasHeight);
+	// GL scissor rects count rows from the bottom of the drawable
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(x0, renderer.windowHeight - y1, x1 - x0, y1 - y0);
+	drawTextLayout(list.layout, renderer);
+	glDisable(GL_SCISSOR_TEST);
+}
+
+#ifdef TEXT_BENCHMARKS
+// Lookup throughput of the flat glyph table against the std::map<unsigned char, Glyph> it replaced
+void benchmarkGlyphLookup(const TextRenderer& renderer) {
+	if (renderer.glyphs.count == 0) return;
 	
-	int x = 0, y = 0;
-	int lineHeight = (int)(fontSize * 1.2f);
+	std::map<unsigned char, Glyph> mapGlyphs;
+	for (uint32_t c = 0; c < kGlyphDenseCount; c++) {
+		const Glyph* glyph = findGlyph(renderer.glyphs, c);
+		if (glyph) mapGlyphs[(unsigned char)c] = *glyph;
+	}
 	
-	for (int c = 32; c < 127; c++) {
-		int glyphIndex = stbtt_FindGlyphIndex(&font, c);
-		
-		int advance, lsb;
-		stbtt_GetGlyphHMetrics(&font, glyphIndex, &advance, &lsb);
-		
-		int width, height, xoff, yoff;
-		unsigned char* bitmap = stbtt_GetGlyphBitmap(&font, scale, scale, glyphIndex, &width, &height, &xoff, &yoff);
-		
-		if (bitmap) {
-			if (x + width + 1 > atlasWidth) {
-				x = 0;
-				y += lineHeight;
-				if (y + height > atlasHeight) {
-					stbtt_FreeBitmap(bitmap, NULL);
-					delete[] atlasData;
-					return false;
-				}
-			}
-			
-			for (int gy = 0; gy < height; gy++) {
-				for (int gx = 0; gx < width; gx++) {
-					int atlasX = x + gx;
-					int atlasY = y + gy;
-					if (atlasX < atlasWidth && atlasY < atlasHeight) {
-						int glyphIdx = gy * width + gx;
-						int atlasIdx = atlasY * atlasWidth + atlasX;
-						atlasData[atlasIdx] = bitmap[glyphIdx];
-					}
-				}
-			}
-			
-			Glyph glyph;
-			glyph.x0 = (float)x / atlasWidth;
-			glyph.y0 = (float)y / atlasHeight;
-			glyph.x1 = (float)(x + width) / atlasWidth;
-			glyph.y1 = (float)(y + height) / atlasHeight;
-			glyph.xoff = (float)xoff;
-			glyph.yoff = (float)yoff;
-			glyph.advance = (float)advance * scale;
-			glyph.width = width;
-			glyph.height = height;
-			
-			renderer.glyphs[(unsigned char)c] = glyph;
-			
-			x += width + 1;
-		}
-		
-		if (bitmap) {
-			stbtt_FreeBitmap(bitmap, NULL);
-		}
+	// Printable ASCII stream from a fixed LCG so both runs see identical input
+	std::vector<unsigned char> text(1 << 20);
+	uint32_t seed = 12345;
+	for (auto& c : text) {
+		seed = seed * 1664525u + 1013904223u;
+		c = (unsigned char)(32 + (seed >> 24) % 95);
 	}
 	
-	// Create OpenGL texture
-	glGenTextures(1, &renderer.fontTexture);
-	glBindTexture(GL_TEXTURE_2D, renderer.fontTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, atlasData);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	const int iterations = 16;
+	const double freq = (double)SDL_GetPerformanceFrequency();
+	volatile uint32_t sink = 0;
 	
-	renderer.fontTextureWidth = atlasWidth;
-	renderer.fontTextureHeight = atlasHeight;
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int it = 0; it < iterations; it++) {
+		uint32_t sum = 0;
+		for (unsigned char c : text) {
+			auto found = mapGlyphs.find(c);
+			if (found != mapGlyphs.end()) sum += found->second.advance;
+		}
+		sink = sink + sum;
+	}
+	double mapSeconds = (double)(SDL_GetPerformanceCounter() - start) / freq;
 	
-	delete[] atlasData;
-	return true;
+	start = SDL_GetPerformanceCounter();
+	for (int it = 0; it < iterations; it++) {
+		uint32_t sum = 0;
+		for (unsigned char c : text) {
+			const Glyph* glyph = findGlyph(renderer.glyphs, c);
+			if (glyph) sum += glyph->advance;
+		}
+		sink = sink + sum;
+	}
+	double tableSeconds = (double)(SDL_GetPerformanceCounter() - start) / freq;
+	
+	double lookups = (double)text.size() * iterations;
+	printf("Glyph lookup: std::map %.1f M/s, flat table %.1f M/s (%.1fx)\n",
+		   lookups / mapSeconds / 1e6, lookups / tableSeconds / 1e6, mapSeconds / tableSeconds);
 }
+#endif
 
-// Create a simple bitmap font texture (this is only a fallback)
-void createBitmapFontTexture(GLuint* texture) {
-	const int charWidth = 8;
-	const int charHeight = 8;
-	const int charsPerRow = 16;
-	const int numRows = 8;
-	
-	const int textureWidth = charsPerRow * charWidth;  // 128 pixels
-	const int textureHeight = numRows * charHeight;    // 64 pixels
-	const int bufferSize = textureWidth * textureHeight; // 8192 bytes
-	unsigned char* fontData = new unsigned char[bufferSize];
-	memset(fontData, 0, bufferSize);
-	
-	for (int c = 32; c < 127; c++) {
-		int charIndex = c - 32;
-		int row = charIndex / charsPerRow;
-		int col = charIndex % charsPerRow;
+#ifdef TEXT_BENCHMARKS
+// SIMD UTF-8 decode against the plain scalar decoder, on pure ASCII and on mixed text
+void benchmarkUtf8Decode() {
+	std::string ascii;
+	while (ascii.size() < (1u << 20)) ascii += "GL_ARB_buffer_storage GL_ARB_texture_view OpenGL Renderer: llvmpipe ";
+	std::string mixed;
+	while (mixed.size() < (1u << 20)) mixed += "Temp\xC3\xA9rature: 42\xC2\xB0" "C \xE2\x80\x94 r\xC3\xA9sum\xC3\xA9 OK ";
+	
+	const int iterations = 32;
+	const double freq = (double)SDL_GetPerformanceFrequency();
+	std::vector<uint32_t> out;
+	volatile size_t sink = 0;
+	const char* names[] = { "ascii", "mixed" };
+	const std::string* inputs[] = { &ascii, &mixed };
+	for (int k = 0; k < 2; k++) {
+		const std::string& input = *inputs[k];
 		
-		int startX = col * charWidth;
-		int startY = row * charHeight;
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int it = 0; it < iterations; it++) {
+			out.resize(input.size());
+			sink = sink + decodeUtf8Scalar((const unsigned char*)input.data(), input.size(), 0, out.data());
+		}
+		double scalarSeconds = (double)(SDL_GetPerformanceCounter() - start) / freq;
+		
+		start = SDL_GetPerformanceCounter();
+		for (int it = 0; it < iterations; it++) {
+			out.clear();
+			sink = sink + decodeUtf8(input, out);
+		}
+		double simdSeconds = (double)(SDL_GetPerformanceCounter() - start) / freq;
 		
-		drawChar(fontData, textureWidth, startX, startY, (unsigned char)c);
+		double megabytes = (double)input.size() * iterations / (1024.0 * 1024.0);
+		printf("UTF-8 decode (%s): scalar %.0f MB/s, fast path %.0f MB/s\n",
+			   names[k], megabytes / scalarSeconds, megabytes / simdSeconds);
 	}
-	
-	glGenTextures(1, texture);
-	glBindTexture(GL_TEXTURE_2D, *texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, textureWidth, textureHeight, 0, GL_RED, GL_UNSIGNED_BYTE, fontData);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	
-	delete[] fontData;
 }
+#endif
 
-void renderText(const std::string& text, float x, float y, float scale, TextRenderer& renderer) {
-	if (text.empty()) return;
+#ifdef TEXT_BENCHMARKS
+// Serial against parallel atlas construction, and a byte-for-byte check of the results
+void benchmarkAtlasBuild(const std::vector<FontFace>& faces, float fontSize, AtlasMode mode) {
+	if (faces.empty()) return;
+	const double freq = (double)SDL_GetPerformanceFrequency();
+	int workers = SDL_GetCPUCount();
 	
-	glUseProgram(renderer.program);
-	glBindVertexArray(renderer.vao);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, renderer.fontTexture);
-	glUniform1i(glGetUniformLocation(renderer.program, "fontTexture"), 0);
+	BakedAtlas serial, parallel;
+	Uint64 start = SDL_GetPerformanceCounter();
+	bool serialOk = bakeFontAtlas(faces, fontSize, mode, 1, 1, serial);
+	double serialMs = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / freq;
 	
-	glUniform2f(glGetUniformLocation(renderer.program, "screenSize"), 
-				(float)renderer.windowWidth, (float)renderer.windowHeight);
-	glUniform3f(glGetUniformLocation(renderer.program, "textColor"), 1.0f, 1.0f, 1.0f);
+	start = SDL_GetPerformanceCounter();
+	bool parallelOk = bakeFontAtlas(faces, fontSize, mode, 1, workers, parallel);
+	double parallelMs = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / freq;
 	
-	float currentX = x;
+	bool identical = serialOk && parallelOk && serial.pixels == parallel.pixels &&
+		memcmp(serial.glyphs.dense, parallel.glyphs.dense, sizeof(serial.glyphs.dense)) == 0;
+	printf("Atlas build: serial %.2f ms, %d workers %.2f ms, %s\n",
+		   serialMs, workers, parallelMs, identical ? "identical" : "MISMATCH");
+}
+#endif
+
+#ifdef TEXT_BENCHMARKS
+// Glyph blits: the original per-pixel, bounds-checked loop, a memcpy per row and blitAtlasRect
+void benchmarkAtlasBlit() {
+	const int atlasSize = 1024;
+	const int glyphWidth = 23, glyphHeight = 31;  // Typical 32 px glyph, odd width on purpose
+	std::vector<unsigned char> atlas((size_t)atlasSize * atlasSize);
+	std::vector<unsigned char> bitmap((size_t)glyphWidth * glyphHeight);
+	uint32_t seed = 12345;
+	for (auto& b : bitmap) {
+		seed = seed * 1664525u + 1013904223u;
+		b = (unsigned char)(seed >> 24);
+	}
 	
-	// Use TTF glyphs if available
-	if (!renderer.glyphs.empty()) {
-		for (size_t i = 0; i < text.length(); i++) {
-			unsigned char c = text[i];
-			if (c < 32 || c >= 127) continue;
-			
-			auto it = renderer.glyphs.find(c);
-			if (it == renderer.glyphs.end()) continue;
-			
-			const Glyph& glyph = it->second;
-			
-			float charX = currentX + glyph.xoff * scale;
-			float charY = y + glyph.yoff * scale;
-			float charWidth = glyph.width * scale;
-			float charHeight = glyph.height * scale;
-			
-			float vertices[] = {
-				charX, charY + charHeight, glyph.x0, glyph.y1,
-				charX + charWidth, charY + charHeight, glyph.x1, glyph.y1,
-				charX + charWidth, charY, glyph.x1, glyph.y0,
-				charX, charY, glyph.x0, glyph.y0
-			};
-			
-			unsigned int indices[] = {
-				0, 1, 2,
-				2, 3, 0
-			};
-			
-			glBindBuffer(GL_ARRAY_BUFFER, renderer.vbo);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
-			
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.ebo);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_DYNAMIC_DRAW);
-			
-			glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(0);
-			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-			glEnableVertexAttribArray(1);
-			
-			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-			
-			currentX += glyph.advance * scale;
-		}
-	} else {
-		// Fallback to bitmap font
-		float charWidth = 8.0f * scale;
-		float charHeight = 8.0f * scale;
-		float charSpacing = 2.0f * scale;
-		const int charsPerRow = 16;
-		const int numRows = 8;
-		
-		for (size_t i = 0; i < text.length(); i++) {
-			char c = text[i];
-			if (c < 32 || c >= 127) continue;
-			
-			int charIndex = c - 32;
-			int texRow = charIndex / charsPerRow;
-			int texCol = charIndex % charsPerRow;
-			
-			float charX = currentX;
-			float charY = y;
-			
-			float texLeft = (float)texCol / charsPerRow;
-			float texRight = (float)(texCol + 1) / charsPerRow;
-			float texTop = (float)texRow / numRows;
-			float texBottom = (float)(texRow + 1) / numRows;
-			
-			float vertices[] = {
-				charX, charY + charHeight, texLeft, texBottom,
-				charX + charWidth, charY + charHeight, texRight, texBottom,
-				charX + charWidth, charY, texRight, texTop,
-				charX, charY, texLeft, texTop
-			};
-			
-			unsigned int indices[] = { 0, 1, 2, 2, 3, 0 };
-			
-			glBindBuffer(GL_ARRAY_BUFFER, renderer.vbo);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
-			
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.ebo);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_DYNAMIC_DRAW);
-			
-			glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(0);
-			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-			glEnableVertexAttribArray(1);
-			
-			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-			
-			currentX += charWidth + charSpacing;
+	// Every glyph slot of the atlas, the last column and row hanging over the edge to exercise clipping
+	std::vector<std::pair<int, int>> slots;
+	for (int y = 0; y < atlasSize; y += glyphHeight + 1) {
+		for (int x = 0; x < atlasSize; x += glyphWidth + 1) slots.push_back(std::make_pair(x, y));
+	}
+	
+	const int iterations = 32;
+	const double freq = (double)SDL_GetPerformanceFrequency();
+	double seconds[3];
+	for (int k = 0; k < 3; k++) {
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int it = 0; it < iterations; it++) {
+			for (const auto& slot : slots) {
+				int x = slot.first, y = slot.second;
+				if (k == 0) {
+					for (int gy = 0; gy < glyphHeight; gy++) {
+						for (int gx = 0; gx < glyphWidth; gx++) {
+							int atlasX = x + gx;
+							int atlasY = y + gy;
+							if (atlasX < atlasSize && atlasY < atlasSize) {
+								atlas[(size_t)atlasY * atlasSize + atlasX] = bitmap[gy * glyphWidth + gx];
+							}
+						}
+					}
+				} else if (k == 1) {
+					int w = std::min(glyphWidth, atlasSize - x);
+					int h = std::min(glyphHeight, atlasSize - y);
+					for (int gy = 0; gy < h; gy++) {
+						memcpy(&atlas[(size_t)(y + gy) * atlasSize + x], &bitmap[gy * glyphWidth], w);
+					}
+				} else {
+					blitAtlasRect(atlas.data(), atlasSize, atlasSize, x, y, bitmap.data(), glyphWidth, glyphWidth, glyphHeight);
+				}
+			}
 		}
+		seconds[k] = (double)(SDL_GetPerformanceCounter() - start) / freq;
 	}
+	
+	double megabytes = (double)slots.size() * glyphWidth * glyphHeight * iterations / (1024.0 * 1024.0);
+	printf("Atlas blit: per pixel %.0f MB/s, memcpy rows %.0f MB/s, blit kernel %.0f MB/s\n",
+		   megabytes / seconds[0], megabytes / seconds[1], megabytes / seconds[2]);
 }
 
-float measureTextWidth(const std::string& text, float scale, const TextRenderer& renderer) {
-	if (!renderer.glyphs.empty()) {
-		float w = 0.0f;
-		for (size_t i = 0; i < text.length(); i++) {
-			unsigned char c = text[i];
-			if (c < 32 || c >= 127) continue;
-			auto it = renderer.glyphs.find(c);
-			if (it != renderer.glyphs.end()) {
-				w += it->second.advance * scale;
+// Box filter throughput of a plain per-texel loop against downsampleAtlasRect, on one atlas level
+void benchmarkAtlasMips() {
+	const int atlasSize = 1024;
+	const int half = atlasSize / 2;
+	std::vector<unsigned char> atlas((size_t)atlasSize * atlasSize);
+	uint32_t seed = 12345;
+	for (auto& b : atlas) {
+		seed = seed * 1664525u + 1013904223u;
+		b = (unsigned char)(seed >> 24);
+	}
+	std::vector<unsigned char> scalar((size_t)half * half), kernel((size_t)half * half);
+	
+	const int iterations = 32;
+	const double freq = (double)SDL_GetPerformanceFrequency();
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int it = 0; it < iterations; it++) {
+		for (int y = 0; y < half; y++) {
+			const unsigned char* row0 = &atlas[(size_t)(2 * y) * atlasSize];
+			const unsigned char* row1 = row0 + atlasSize;
+			for (int x = 0; x < half; x++) {
+				scalar[(size_t)y * half + x] = (unsigned char)((row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >> 2);
 			}
 		}
-		return w;
-	} else {
-		float charWidth = 8.0f * scale;
-		float charSpacing = 2.0f * scale;
-		return (charWidth + charSpacing) * (float)text.size();
 	}
+	double scalarSeconds = (double)(SDL_GetPerformanceCounter() - start) / freq;
+	
+	start = SDL_GetPerformanceCounter();
+	for (int it = 0; it < iterations; it++) {
+		downsampleAtlasRect(kernel.data(), half, atlas.data(), atlasSize, half, half);
+	}
+	double kernelSeconds = (double)(SDL_GetPerformanceCounter() - start) / freq;
+	
+	double megabytes = (double)atlas.size() * iterations / (1024.0 * 1024.0);
+	printf("Atlas mips: per texel %.0f MB/s, box filter kernel %.0f MB/s, %s\n", megabytes / scalarSeconds,
+		   megabytes / kernelSeconds, scalar == kernel ? "identical" : "MISMATCH");
 }
+#endif
 
-bool initTextRenderer(TextRenderer& renderer, int width, int height) {
-	renderer.windowWidth = width;
-	renderer.windowHeight = height;
-	
+GLuint buildShaderProgram(const char* vsSource, const char* fsSource) {
 	// Compile vertex shader
 	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+	glShaderSource(vertexShader, 1, &vsSource, NULL);
 	glCompileShader(vertexShader);
 	
 	// Check compilation
@@ -684,7 +3415,7 @@ bool initTextRenderer(TextRenderer& renderer, int width, int height) {
 	
 	// Compile fragment shader
 	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
+	glShaderSource(fragmentShader, 1, &fsSource, NULL);
 	glCompileShader(fragmentShader);
 	
 	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
@@ -693,50 +3424,255 @@ bool initTextRenderer(TextRenderer& renderer, int width, int height) {
 		printf("Fragment shader compilation failed: %s\n", infoLog);
 	}
 	
-	renderer.program = glCreateProgram();
-	glAttachShader(renderer.program, vertexShader);
-	glAttachShader(renderer.program, fragmentShader);
-	glLinkProgram(renderer.program);
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
 	
-	glGetProgramiv(renderer.program, GL_LINK_STATUS, &success);
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
 	if (!success) {
-		glGetProgramInfoLog(renderer.program, 512, NULL, infoLog);
+		glGetProgramInfoLog(program, 512, NULL, infoLog);
 		printf("Program linking failed: %s\n", infoLog);
 	}
 	
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
 	
-	// Create VAO, VBO, EBO
+	return program;
+}
+
+// Set the distance field effect uniforms, which stay constant until the effects change
+static void applyTextEffects(GLuint program, const TextEffects& effects) {
+	glUseProgram(program);
+	glUniform4fv(glGetUniformLocation(program, "outlineColor"), 1, effects.outlineColor);
+	glUniform1f(glGetUniformLocation(program, "outlineWidth"), effects.outlineWidth);
+	glUniform4fv(glGetUniformLocation(program, "shadowColor"), 1, effects.shadowColor);
+	glUniform2fv(glGetUniformLocation(program, "shadowOffset"), 1, effects.shadowOffset);
+	glUseProgram(0);
+}
+
+// (Re)build both text programs with the shaders matching the current atlas mode
+void buildTextPrograms(TextRenderer& renderer) {
+	if (renderer.program) glDeleteProgram(renderer.program);
+	if (renderer.instanceProgram) glDeleteProgram(renderer.instanceProgram);
+	
+	if (renderer.atlasMode == AtlasMode::Vector) {
+		renderer.program = buildShaderProgram(vectorVertexShaderSource, vectorFragmentShaderSource);
+		renderer.instanceProgram = buildShaderProgram(vectorInstancedVertexShaderSource, vectorFragmentShaderSource);
+	} else {
+		const char* fsSource = (renderer.atlasMode == AtlasMode::DistanceField) ? sdfFragmentShaderSource : fragmentShaderSource;
+		renderer.program = buildShaderProgram(vertexShaderSource, fsSource);
+		renderer.instanceProgram = buildShaderProgram(instancedVertexShaderSource, fsSource);
+	}
+	
+	renderer.screenSizeLoc = glGetUniformLocation(renderer.program, "screenSize");
+	renderer.fontTextureLoc = glGetUniformLocation(renderer.program, "fontTexture");
+	renderer.instanceScreenSizeLoc = glGetUniformLocation(renderer.instanceProgram, "screenSize");
+	renderer.instanceFontTextureLoc = glGetUniformLocation(renderer.instanceProgram, "fontTexture");
+	
+	if (renderer.atlasMode == AtlasMode::DistanceField) {
+		applyTextEffects(renderer.program, renderer.effects);
+		applyTextEffects(renderer.instanceProgram, renderer.effects);
+	}
+}
+
+// Opt in to an outline or shadow; they take effect whenever a distance field atlas is in use
+void setTextEffects(TextRenderer& renderer, const TextEffects& effects) {
+	renderer.effects = effects;
+	if (renderer.atlasMode == AtlasMode::DistanceField) {
+		applyTextEffects(renderer.program, effects);
+		applyTextEffects(renderer.instanceProgram, effects);
+	}
+}
+
+// Base pixel height of the overlay text for a drawable height, in whole pixels so a coverage
+// atlas baked at this size is drawn at scale 1
+float overlayTextPixels(int windowHeight) {
+	float px = (float)windowHeight / 60.0f;
+	if (px < 12.0f) px = 12.0f;
+	if (px > 20.0f) px = 20.0f;
+	return floorf(px + 0.5f);
+}
+
+// Distance fields scale cleanly, so they are baked once at a fixed size
+const float kSdfBakeSize = 32.0f;
+
+// Pixel height to rasterize the atlas at. Coverage atlases are baked at the size the
+// overlay text is drawn at on screen, so the overlay samples texels 1:1.
+float atlasFontSize(AtlasMode mode, int windowHeight) {
+	if (mode == AtlasMode::DistanceField) return kSdfBakeSize;
+	return overlayTextPixels(windowHeight);
+}
+
+// Re-bake the open fonts in another atlas format and switch the programs over
+bool rebuildFontAtlas(TextRenderer& renderer, AtlasMode mode, int subpixelPhases) {
+	if (renderer.faces.empty()) return false;
+	float fontSize = atlasFontSize(mode, renderer.windowHeight);
+	if (!prepareFontAtlas(renderer.faces, fontSize, mode, subpixelPhases, renderer)) return false;
+	buildTextPrograms(renderer);
+	return true;
+}
+
+bool initTextRenderer(TextRenderer& renderer, int width, int height) {
+	renderer.windowWidth = width;
+	renderer.windowHeight = height;
+	
+	// Create VAO, VBO, EBO; the VAO keeps the attribute layout and index buffer binding
 	glGenVertexArrays(1, &renderer.vao);
 	glGenBuffers(1, &renderer.vbo);
 	glGenBuffers(1, &renderer.ebo);
 	
-	const char* fontPaths[] = {
-		"fonts/RobotoMono-Medium.ttf",
-		"uwp/fonts/RobotoMono-Medium.ttf",
-		"RobotoMono-Medium.ttf"
+	glBindVertexArray(renderer.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, renderer.vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.ebo);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, x));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, u));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextVertex), (void*)offsetof(TextVertex, color));
+	glEnableVertexAttribArray(2);
+	glBindVertexArray(0);
+	ensureQuadIndices(renderer, 1024);
+	
+	// Instanced VAO: every attribute advances once per glyph
+	glGenVertexArrays(1, &renderer.instanceVao);
+	glGenBuffers(1, &renderer.instanceVbo);
+	
+	glBindVertexArray(renderer.instanceVao);
+	glBindBuffer(GL_ARRAY_BUFFER, renderer.instanceVbo);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, x0));
+	glEnableVertexAttribArray(0);
+	glVertexAttribDivisor(0, 1);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, u0));
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, color));
+	glEnableVertexAttribArray(2);
+	glVertexAttribDivisor(2, 1);
+	glBindVertexArray(0);
+	
+	// Fallback chain: the UI font, wider Latin coverage, controller prompts, then icons
+	const char* fontNames[] = {
+		"RobotoMono-Medium.ttf",
+		"Roboto-Regular.ttf",
+		"promptfont.otf",
+		"fa-solid-900.ttf"
+	};
+	const char* fontDirs[] = {
+		"fonts/",
+		"uwp/fonts/",
+		""
 	};
 	
-	bool fontLoaded = false;
-	for (int i = 0; i < 3; i++) {
-		std::ifstream testFile(fontPaths[i], std::ios::binary);
-		if (testFile.good()) {
-			testFile.close();
-			if (loadTTFFont(fontPaths[i], renderer, 32.0f)) {
-				fontLoaded = true;
+	std::vector<std::string> fontPaths;
+	for (int i = 0; i < 4; i++) {
+		for (int d = 0; d < 3; d++) {
+			std::string path = std::string(fontDirs[d]) + fontNames[i];
+			std::ifstream testFile(path.c_str(), std::ios::binary);
+			if (testFile.good()) {
+				fontPaths.push_back(path);
 				break;
 			}
 		}
 	}
 	
+	const AtlasMode mode = AtlasMode::Coverage;
+	bool fontLoaded = !fontPaths.empty() && loadFontCollection(fontPaths, renderer, atlasFontSize(mode, height), mode, 1);
+	
 	if (!fontLoaded) {
 		createBitmapFontTexture(&renderer.fontTexture);
+		renderer.atlasMode = AtlasMode::Coverage;
+	}
+	buildTextPrograms(renderer);
+	
+	return true;
+}
+
+bool initOverlayCompositor(OverlayCompositor& compositor) {
+	compositor.program = buildShaderProgram(compositeVertexShaderSource, compositeFragmentShaderSource);
+	compositor.overlayTextureLoc = glGetUniformLocation(compositor.program, "overlayTexture");
+	
+	// Core profile needs a bound VAO even though the triangle has no attributes
+	glGenVertexArrays(1, &compositor.vao);
+	glGenFramebuffers(1, &compositor.fbo);
+	glGenTextures(1, &compositor.texture);
+	compositor.dirty = true;
+	return compositor.program != 0;
+}
+
+// Resize the layer to the drawable size; any size change forces a redraw
+static bool resizeOverlayLayer(OverlayCompositor& compositor, int width, int height) {
+	if (compositor.width == width && compositor.height == height) return true;
+	
+	glBindTexture(GL_TEXTURE_2D, compositor.texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	
+	glBindFramebuffer(GL_FRAMEBUFFER, compositor.fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, compositor.texture, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		printf("Overlay framebuffer incomplete (0x%x), drawing text directly\n", status);
+		compositor.enabled = false;
+		return false;
 	}
 	
+	compositor.width = width;
+	compositor.height = height;
+	compositor.dirty = true;
+	return true;
+}
+
+// Bind the layer as the render target if it has to be redrawn. Returns false when the
+// cached layer is still valid and nothing needs to be drawn into it.
+bool beginOverlayLayer(OverlayCompositor& compositor, int width, int height) {
+	if (!resizeOverlayLayer(compositor, width, height)) return false;
+	if (!compositor.dirty) return false;
+	
+	glBindFramebuffer(GL_FRAMEBUFFER, compositor.fbo);
+	glViewport(0, 0, width, height);
+	glDisable(GL_DEPTH_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	
+	// Accumulate premultiplied color so the layer can be composited with (ONE, ONE_MINUS_SRC_ALPHA)
+	glEnable(GL_BLEND);
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 	return true;
 }
 
+void endOverlayLayer(OverlayCompositor& compositor) {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, compositor.width, compositor.height);
+	compositor.dirty = false;
+}
+
+// Blend the cached layer over the current framebuffer with one fullscreen triangle
+void compositeOverlay(const OverlayCompositor& compositor) {
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	
+	glUseProgram(compositor.program);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, compositor.texture);
+	glUniform1i(compositor.overlayTextureLoc, 0);
+	glBindVertexArray(compositor.vao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void destroyOverlayCompositor(OverlayCompositor& compositor) {
+	glDeleteFramebuffers(1, &compositor.fbo);
+	glDeleteTextures(1, &compositor.texture);
+	glDeleteVertexArrays(1, &compositor.vao);
+	glDeleteProgram(compositor.program);
+	compositor = OverlayCompositor();
+}
+
 bool initCubeRenderer(CubeRenderer& renderer) {
 	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(vs, 1, &cubeVertexShaderSource, NULL);
@@ -1040,6 +3976,70 @@ std::vector<std::string> getOpenGLInfo() {
 	return info;
 }
 
+// Overlay palette
+const uint32_t kOverlayHeaderColor = packTextColor(0xFF, 0xC8, 0x57);
+const uint32_t kOverlayLabelColor = packTextColor(0x9F, 0xB3, 0xC8);
+const uint32_t kOverlayVendorColor = packTextColor(0x7F, 0xD1, 0xB9);
+
+// Info line colors: section headers whole, "Label: value" with a dimmed label and
+// extension names with their GL_VENDOR_ prefix highlighted
+static std::vector<TextColorSpan> overlayLineSpans(const std::string& line, bool header) {
+	if (header) return { { 0, kOverlayHeaderColor } };
+	
+	size_t name = line.find_first_not_of(' ');
+	if (name != std::string::npos && line.compare(name, 3, "GL_") == 0) {
+		size_t vendorEnd = line.find('_', name + 3);
+		if (vendorEnd != std::string::npos) return { { 0, kOverlayVendorColor }, { vendorEnd + 1, kTextWhite } };
+		return {};
+	}
+	size_t colon = line.find(':');
+	if (colon != std::string::npos) return { { 0, kOverlayLabelColor }, { colon + 1, kTextWhite } };
+	return {};
+}
+
+// Place the panels for the current drawable size. Block 0 is the left info panel, block 1 the
+// extension header above the scrolling extension list.
+void updateOverlayBlocks(TextLayout& layout, TextList& extensions, const TextRenderer& renderer) {
+	// Line pitches and offsets are whole pixels too, so baselines stay on the pixel grid
+	float baseTextPx = overlayTextPixels(renderer.windowHeight);
+	
+	TextBlock& left = layout.blocks[0];
+	if (renderer.faces.empty()) {
+		left.scale = baseTextPx / 8.0f;
+		left.lineHeight = floorf(baseTextPx * 1.3f + 0.5f);
+	} else {
+		left.scale = baseTextPx / renderer.fontSize;
+		left.lineHeight = floorf(baseTextPx * 1.3f + 0.5f);
+	}
+	left.x = 28.0f;
+	left.y = baseTextPx;
+	
+	TextBlock& right = layout.blocks[1];
+	if (renderer.faces.empty()) {
+		right.scale = (baseTextPx * 1.0f) / 8.0f;
+		right.lineHeight = floorf(baseTextPx * 1.10f + 0.5f);
+	} else {
+		// Same size as the info panel: the list scrolls, so it need not be shrunk to fit
+		right.scale = baseTextPx / renderer.fontSize;
+		right.lineHeight = floorf(baseTextPx * 1.10f + 0.5f);
+	}
+	const float rightMargin = floorf(baseTextPx * 0.75f + 0.5f);
+	right.x = (float)renderer.windowWidth - rightMargin;
+	right.y = baseTextPx;
+	right.bottomLimit = (float)renderer.windowHeight - baseTextPx;
+	right.columnPadding = baseTextPx;
+	
+	// The list takes the right half of the window under the header
+	extensions.view = { (float)renderer.windowWidth * 0.5f, floorf(right.y + right.lineHeight * 0.4f),
+						right.x, (float)renderer.windowHeight - baseTextPx };
+	extensions.rowHeight = right.lineHeight;
+	extensions.baseline = floorf(right.lineHeight * 0.8f + 0.5f);
+	extensions.scale = right.scale;
+	extensions.layout.dirty = true;
+	
+	layout.dirty = true;
+}
+
 // You can locally declare a SDL_main function or call to a DLL export (mingw works nice for this) 
 int SDL_main(int argc, char* argv[])
 {
@@ -1086,17 +4086,9 @@ int SDL_main(int argc, char* argv[])
 	SDL_GL_GetDrawableSize(window, &windowWidth, &windowHeight);
 	glViewport(0, 0, windowWidth, windowHeight);
 	
-	// Compute DPI scale so text stays reasonable across DPI settings
-	float dpiScale = 1.0f;
-	int displayIndex = SDL_GetWindowDisplayIndex(window);
-	float ddpi=96.0f, hdpi=96.0f, vdpi=96.0f;
-	if (displayIndex >= 0 && SDL_GetDisplayDPI(displayIndex, &ddpi, &hdpi, &vdpi) == 0 && ddpi > 0.0f) {
-		dpiScale = 96.0f / ddpi; // >1.0 on low DPI, <1.0 on high DPI
-	}
-	
-	// Initialize text renderer
+	// Initialize text renderer. The drawable size is in physical pixels, so the atlas size
+	// derived from it already accounts for the display DPI.
 	TextRenderer textRenderer;
-	textRenderer.fontSize = 24.0f * dpiScale;
 	if (!initTextRenderer(textRenderer, windowWidth, windowHeight)) {
 		SDL_GL_DeleteContext(glContext);
 		SDL_DestroyWindow(window);
@@ -1104,6 +4096,32 @@ int SDL_main(int argc, char* argv[])
 		return -1;
 	}
 	
+#ifdef TEXT_BENCHMARKS
+	benchmarkGlyphLookup(textRenderer);
+	benchmarkUtf8Decode();
+	benchmarkAtlasBlit();
+	benchmarkAtlasMips();
+	benchmarkAtlasBuild(textRenderer.faces, textRenderer.fontSize, textRenderer.atlasMode);
+#endif
+	
+	// Ring for text queued every frame (the statistics line). Retained layouts keep their own
+	// buffers. Regions grow on demand if more is streamed.
+	StreamBuffer streamBuffer;
+	if (initStreamBuffer(streamBuffer, 16 * 1024)) {
+		textRenderer.stream = &streamBuffer;
+	} else {
+		printf("Stream buffer unavailable, falling back to glBufferData uploads\n");
+		destroyStreamBuffer(streamBuffer);
+	}
+	
+	OverlayCompositor overlayCompositor;
+	if (!initOverlayCompositor(overlayCompositor)) {
+		overlayCompositor.enabled = false;
+	}
+	
+	// Re-bakes the atlas in the background when the on-screen text size changes
+	AtlasRebuild atlasRebuild;
+	
 	// Initialize 3D cube renderer
 	CubeRenderer cubeRenderer;
 	initCubeRenderer(cubeRenderer);
@@ -1133,13 +4151,46 @@ int SDL_main(int argc, char* argv[])
 		}
 	}
 	
+	// Section icons come from fa-solid-900 through the font fallback chain
+	const std::string iconMicrochip = "\xEF\x8B\x9B";  // U+F2DB
+	const std::string iconDesktop = "\xEF\x84\x88";    // U+F108
+	
 	std::vector<std::string> leftInfo;
-	leftInfo.push_back("OPENGL INFORMATION");
+	leftInfo.push_back(iconMicrochip + " OPENGL INFORMATION");
 	for (const auto& line : glCoreInfo) leftInfo.push_back(line);
 	leftInfo.push_back("");
-	leftInfo.push_back("SYSTEM INFORMATION");
+	leftInfo.push_back(iconDesktop + " SYSTEM INFORMATION");
 	for (const auto& line : systemInfo) leftInfo.push_back(line);
 	
+	// The info panel and the extension header are static after startup, so they live in one
+	// retained layout. The extensions themselves scroll in a list below the header.
+	TextLayout overlayLayout;
+	overlayLayout.blocks.resize(2);
+	overlayLayout.blocks[0].lines = leftInfo;
+	overlayLayout.blocks[0].flow = TextFlow::Stacked;
+	if (!glExtInfo.empty()) overlayLayout.blocks[1].lines.push_back(glExtInfo[0]);
+	overlayLayout.blocks[1].flow = TextFlow::RightAlignedColumns;
+	
+	TextList extensionList;
+	if (glExtInfo.size() > 1) extensionList.rows.assign(glExtInfo.begin() + 1, glExtInfo.end());
+	
+	// Colors travel with the vertices, so the colored panels still draw in one call
+	for (const auto& line : leftInfo) {
+		bool header = line.rfind(iconMicrochip, 0) == 0 || line.rfind(iconDesktop, 0) == 0;
+		overlayLayout.blocks[0].lineSpans.push_back(overlayLineSpans(line, header));
+	}
+	overlayLayout.blocks[1].color = kOverlayHeaderColor;
+	for (const auto& row : extensionList.rows) {
+		extensionList.rowSpans.push_back(overlayLineSpans(row, false));
+	}
+	
+	// Frame statistics are queued again every frame and streamed through the ring, on top of
+	// the overlay, so they never rebuild the panels or dirty the cached layer
+	TextBatch statsBatch;
+	std::string statsText;
+	Uint64 statsStart = SDL_GetPerformanceCounter();
+	int statsFrames = 0;
+	
 	SDL_Event event;
 	bool running = true;
 	while (running) {
@@ -1147,8 +4198,39 @@ int SDL_main(int argc, char* argv[])
 			if (event.type == SDL_QUIT) {
 				running = false;
 				break;
+			} else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F1 && !event.key.repeat) {
+				// Toggle between the quad and instanced glyph pipelines for benchmarking
+				textRenderer.pipeline = (textRenderer.pipeline == TextPipeline::Quads) ? TextPipeline::Instanced : TextPipeline::Quads;
+				printf("Text pipeline: %s\n", textRenderer.pipeline == TextPipeline::Quads ? "quads" : "instanced");
+			} else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F2 && !event.key.repeat) {
+				// Toggle the cached overlay layer against drawing the text every frame
+				overlayCompositor.enabled = !overlayCompositor.enabled && overlayCompositor.program != 0;
+				overlayCompositor.dirty = true;
+				printf("Overlay compositor: %s\n", overlayCompositor.enabled ? "on" : "off");
+			} else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3 && !event.key.repeat) {
+				// Cycle the coverage atlas, the distance field atlas and vector text
+				const char* modeNames[] = { "coverage", "distance field", "vector" };
+				AtlasMode mode = (AtlasMode)(((int)textRenderer.atlasMode + 1) % 3);
+				cancelAtlasRebuild(atlasRebuild);
+				if (rebuildFontAtlas(textRenderer, mode, textRenderer.subpixelPhases)) {
+					printf("Font atlas: %s\n", modeNames[(int)mode]);
+				}
+			} else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F4 && !event.key.repeat &&
+					   textRenderer.atlasMode == AtlasMode::Coverage) {
+				// Cycle the subpixel variants of coverage glyphs: off, 2, 3, 4
+				int phases = textRenderer.subpixelPhases % kMaxSubpixelPhases + 1;
+				cancelAtlasRebuild(atlasRebuild);
+				if (rebuildFontAtlas(textRenderer, textRenderer.atlasMode, phases)) {
+					printf("Subpixel phases: %d\n", textRenderer.subpixelPhases);
+				}
+			} else if (event.type == SDL_MOUSEWHEEL) {
+				scrollTextList(extensionList, -(float)event.wheel.y * extensionList.rowHeight * 3.0f);
+			} else if (event.type == SDL_KEYDOWN && (event.key.keysym.sym == SDLK_PAGEUP || event.key.keysym.sym == SDLK_PAGEDOWN)) {
+				float page = extensionList.view.y1 - extensionList.view.y0 - extensionList.rowHeight;
+				scrollTextList(extensionList, event.key.keysym.sym == SDLK_PAGEUP ? -page : page);
 			} else if (event.type == SDL_WINDOWEVENT) {
-				if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
+				if (event.window.event == SDL_WINDOWEVENT_RESIZED || event.window.event == SDL_WINDOWEVENT_DISPLAY_CHANGED) {
+					overlayLayout.dirty = true;
 					SDL_GL_GetDrawableSize(window, &windowWidth, &windowHeight);
 					textRenderer.windowWidth = windowWidth;
 					textRenderer.windowHeight = windowHeight;
@@ -1163,6 +4245,23 @@ int SDL_main(int argc, char* argv[])
 		textRenderer.windowHeight = windowHeight;
 		glViewport(0, 0, windowWidth, windowHeight);
 		
+		if (textRenderer.stream) beginStreamFrame(*textRenderer.stream);
+		beginTextFrame(textRenderer);
+		
+		// Both layouts are drawn this frame; keep their pages out of reach of the rebuilds below
+		touchTextLayout(overlayLayout, textRenderer);
+		touchTextLayout(extensionList.layout, textRenderer);
+		
+		// Keep the atlas rasterized at the current on-screen size (window resized or moved to
+		// a display with another DPI). The old atlas draws until the new one is uploaded.
+		if (finishAtlasRebuild(atlasRebuild, textRenderer)) {
+			printf("Font atlas rebuilt at %.0f px\n", textRenderer.fontSize);
+		}
+		float atlasSize = atlasFontSize(textRenderer.atlasMode, windowHeight);
+		if (!textRenderer.faces.empty() && atlasSize != textRenderer.fontSize) {
+			startAtlasRebuild(atlasRebuild, textRenderer, atlasSize, textRenderer.atlasMode, textRenderer.subpixelPhases);
+		}
+		
 		glEnable(GL_DEPTH_TEST);
 		glClearColor(0.05f, 0.10f, 0.25f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -1183,78 +4282,79 @@ int SDL_main(int argc, char* argv[])
 		glUniformMatrix4fv(loc, 1, GL_FALSE, mvp);
 		glDrawArrays(GL_TRIANGLES, 0, 36);
 		
-		// Enable blending for text
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		
-		float baseTextPx = (float)windowHeight / 60.0f;
-		if (baseTextPx < 12.0f) baseTextPx = 12.0f;
-		if (baseTextPx > 20.0f) baseTextPx = 20.0f;
+		statsFrames++;
+		Uint64 now = SDL_GetPerformanceCounter();
+		double statsSeconds = (double)(now - statsStart) / (double)SDL_GetPerformanceFrequency();
+		if (statsSeconds >= 0.5) {
+			char stats[64];
+			snprintf(stats, sizeof(stats), "%.1f FPS  %.2f ms", statsFrames / statsSeconds, statsSeconds * 1000.0 / statsFrames);
+			statsText = stats;
+			statsStart = now;
+			statsFrames = 0;
+		}
 		
-		float scaleLeft;
-		float lineHeightLeft;
-		if (textRenderer.glyphs.empty()) {
-			scaleLeft = baseTextPx / 8.0f;
-			lineHeightLeft = baseTextPx * 1.3f;
-		} else {
-			scaleLeft = baseTextPx / textRenderer.fontSize;
-			lineHeightLeft = baseTextPx * 1.3f;
+		if (textLayoutNeedsBuild(overlayLayout, textRenderer)) {
+			updateOverlayBlocks(overlayLayout, extensionList, textRenderer);
+			buildTextLayout(overlayLayout, textRenderer);
+			overlayCompositor.dirty = true;
 		}
-		float yLeft = baseTextPx;
-		for (const auto& line : leftInfo) {
-			renderText(line, 28.0f, yLeft, scaleLeft, textRenderer);
-			yLeft += lineHeightLeft;
+		if (updateTextList(extensionList, textRenderer)) {
+			overlayCompositor.dirty = true;
 		}
-
-		float scaleRight;
-		float lineHeightRight;
-		if (textRenderer.glyphs.empty()) {
-			scaleRight = (baseTextPx * 1.0f) / 8.0f;
-			lineHeightRight = baseTextPx * 1.10f;
-		} else {
-			scaleRight = (baseTextPx * 0.85f) / textRenderer.fontSize;
-			lineHeightRight = baseTextPx * 0.95f;
-		}
-		const float rightMargin = baseTextPx * 0.75f;
-		float yRightTop = baseTextPx;
-		float yRight = yRightTop;
-		float bottomLimit = (float)windowHeight - baseTextPx;
-		float currentRightEdge = (float)windowWidth - rightMargin;
-		float colPadding = baseTextPx;
-		float maxColWidth = 0.0f;
-		if (!glExtInfo.empty()) {
-			for (const auto& line : glExtInfo) {
-				if (yRight + lineHeightRight > bottomLimit) {
-					currentRightEdge -= (maxColWidth + colPadding);
-					yRight = yRightTop;
-					maxColWidth = 0.0f;
-					if (currentRightEdge < 0.0f) currentRightEdge = (float)windowWidth - rightMargin;
-				}
-
-				float textWidth = measureTextWidth(line, scaleRight, textRenderer);
-				if (textWidth > maxColWidth) maxColWidth = textWidth;
-				float startX = currentRightEdge - textWidth;
-				if (startX < 0.0f) startX = 0.0f;
-				renderText(line, startX, yRight, scaleRight, textRenderer);
-				yRight += lineHeightRight;
+		
+		if (overlayCompositor.enabled) {
+			if (beginOverlayLayer(overlayCompositor, windowWidth, windowHeight)) {
+				drawTextLayout(overlayLayout, textRenderer);
+				drawTextList(extensionList, textRenderer);
+				endOverlayLayer(overlayCompositor);
 			}
 		}
+		if (overlayCompositor.enabled) {
+			compositeOverlay(overlayCompositor);
+		} else {
+			// Enable blending for text
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			drawTextLayout(overlayLayout, textRenderer);
+			drawTextList(extensionList, textRenderer);
+		}
+		
+		// Frame statistics along the bottom left, in the info panel's style
+		const TextBlock& infoPanel = overlayLayout.blocks[0];
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		statsBatch.pipeline = textRenderer.pipeline;
+		statsBatch.color = kOverlayHeaderColor;
+		queueText(statsBatch, statsText, infoPanel.x, (float)windowHeight - infoPanel.y * 0.5f, infoPanel.scale, textRenderer);
+		flushTextBatch(statsBatch, textRenderer);
 		
 		glDisable(GL_BLEND);
+		
+		if (textRenderer.stream) endStreamFrame(*textRenderer.stream);
 
 		// Swap buffers
 		SDL_GL_SwapWindow(window);
 	}
 
 	// Cleanup
+	cancelAtlasRebuild(atlasRebuild);
 	glDeleteVertexArrays(1, &cubeRenderer.vao);
 	glDeleteBuffers(1, &cubeRenderer.vbo);
 	glDeleteProgram(cubeRenderer.program);
 	glDeleteTextures(1, &textRenderer.fontTexture);
+	glDeleteTextures(1, &textRenderer.outlines.texture);
+	glDeleteBuffers(1, &textRenderer.outlines.buffer);
 	glDeleteVertexArrays(1, &textRenderer.vao);
 	glDeleteBuffers(1, &textRenderer.vbo);
 	glDeleteBuffers(1, &textRenderer.ebo);
 	glDeleteProgram(textRenderer.program);
+	glDeleteVertexArrays(1, &textRenderer.instanceVao);
+	glDeleteBuffers(1, &textRenderer.instanceVbo);
+	glDeleteProgram(textRenderer.instanceProgram);
+	destroyStreamBuffer(streamBuffer);
+	destroyTextLayout(overlayLayout);
+	destroyTextLayout(extensionList.layout);
+	destroyOverlayCompositor(overlayCompositor);
 	SDL_GL_DeleteContext(glContext);
 	SDL_DestroyWindow(window);
 	SDL_Quit();